@@ -0,0 +1,76 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+// What the benchmarks have in common. Every benchmark is an executable of its own, so this is all inline.
+
+// Every measurement is the best of this many runs, to filter out noise from the rest of the system
+const int NUM_RUNS = 5;
+
+// The texture sampling benchmarks sample a square of this many pixels on a side
+const int SCREEN_SIZE = 1024;
+
+// Calls run NUM_RUNS times and returns the fastest time in milliseconds. prepare is called before every run, outside
+// of the timing, to undo whatever the run before changed.
+template <typename Prepare, typename Run>
+double TimeBestRun(Prepare&& prepare, Run&& run)
+{
+    double bestTime = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < NUM_RUNS; i++)
+    {
+        prepare();
+
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+
+        bestTime = std::min(bestTime, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return bestTime;
+}
+
+template <typename Run>
+double TimeBestRun(Run&& run)
+{
+    return TimeBestRun([]() {}, run);
+}
+
+// The texture coordinates of the pixels of the screen, with the texture rotated by an angle around its center. At 0
+// degrees the pixels of a row walk along a row of texels, at 90 they walk down a column.
+struct RotatedTexCoords
+{
+    // The corner of the screen, and the steps from one pixel to the next along a row and down a column
+    glm::vec2 Origin;
+    glm::vec2 StepX;
+    glm::vec2 StepY;
+
+    inline glm::vec2 At(int x, int y) const
+    {
+        return Origin + StepX * static_cast<float>(x) + StepY * static_cast<float>(y);
+    }
+};
+
+// Neighbouring pixels are scale texture sizes divided by SCREEN_SIZE apart, so about scale texels for a texture as
+// large as the screen, and the texture repeats scale times across the screen
+inline RotatedTexCoords GetRotatedTexCoords(float angle, float scale)
+{
+    float radians = angle * 3.14159265f / 180.0f;
+    float step    = scale / SCREEN_SIZE;
+
+    RotatedTexCoords texCoords;
+    texCoords.StepX = glm::vec2(std::cos(radians), std::sin(radians)) * step;
+    texCoords.StepY = glm::vec2(-std::sin(radians), std::cos(radians)) * step;
+
+    // The center of the screen lands on the center of the texture. The corners of the rotated screen fall outside of
+    // the texture, where the sampler wraps around.
+    texCoords.Origin = glm::vec2(0.5f) - (texCoords.StepX + texCoords.StepY) * (SCREEN_SIZE / 2.0f);
+
+    return texCoords;
+}
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "Benchmarks/benchmark.h"
+#include "Utilities/meshcache.h"
+#include "Utilities/model.h"
+#include "Utilities/threadpool.h"
+
+enum class Loader
+{
+    // Parsing with tinyobjloader, without a mesh cache
+    TinyObj,
+    // Parsing with the multithreaded parser, without a mesh cache
+    Parallel,
+    // Mapping the mesh cache written by an earlier load
+    MeshCache,
+};
+
+// The most memory the process has had resident at any point so far, in bytes
+size_t GetPeakResidentMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    // Linux reports it in kilobytes
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// Loads the model NUM_RUNS times and returns the fastest time in milliseconds
+double TimeLoad(const std::string& filename, Loader loader, ThreadPool& threadPool)
+{
+    std::string cacheFilename = filename + MESH_CACHE_EXTENSION;
+
+    // The first load writes the cache the others read
+    if (loader == Loader::MeshCache)
+    {
+        Model model(filename, threadPool);
+    }
+
+    auto prepare = [&]() {
+        if (loader != Loader::MeshCache)
+        {
+            std::remove(cacheFilename.c_str());
+        }
+    };
+
+    return TimeBestRun(prepare, [&]() {
+        if (loader == Loader::TinyObj)
+        {
+            Model model(filename);
+        }
+        else
+        {
+            Model model(filename, threadPool);
+        }
+    });
+}
+
+// The peak memory use of a process never goes down, so every loader gets a process of its own:
+//
+//     LoadBenchmark tinyobj | parallel | cache
+//
+// The parsing loaders delete the mesh cache before every load, so that they include writing it again.
+int main(int argc, char** argv)
+{
+    const std::vector<std::string> models = {
+        "../Assets/obj/african_head/african_head.obj",
+        "../Assets/obj/diablo3_pose/diablo3_pose.obj",
+    };
+
+    Loader      loader     = Loader::Parallel;
+    const char* loaderName = argc > 1 ? argv[1] : "parallel";
+
+    if (std::strcmp(loaderName, "tinyobj") == 0)
+    {
+        loader = Loader::TinyObj;
+    }
+    else if (std::strcmp(loaderName, "cache") == 0)
+    {
+        loader = Loader::MeshCache;
+    }
+    else if (std::strcmp(loaderName, "parallel") != 0)
+    {
+        std::cerr << "Usage: LoadBenchmark [tinyobj | parallel | cache]\n";
+        return 1;
+    }
+
+    ThreadPool threadPool;
+
+    // What the process takes before loading anything, mostly the executable and the thread stacks
+    size_t baseMemory = GetPeakResidentMemory();
+
+    std::vector<double> times;
+    std::vector<size_t> peakMemory;
+
+    for (const std::string& filename : models)
+    {
+        times.push_back(TimeLoad(filename, loader, threadPool));
+        peakMemory.push_back(GetPeakResidentMemory());
+    }
+
+    std::cout << "\nLoading with " << loaderName << " on " << threadPool.GetNumThreads() << " threads, peak memory "
+              << "is for the whole process up to and including that model\n";
+    std::cout << std::left << std::setw(48) << "Model" << std::right << std::setw(12) << "Time (ms)" << std::setw(20)
+              << "Peak memory (MB)\n";
+
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        std::cout << std::left << std::setw(48) << models[i] << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << times[i] << std::setw(19) << peakMemory[i] / (1024.0 * 1024.0) << "\n";
+    }
+    std::cout << "Before loading: " << std::fixed << std::setprecision(2) << baseMemory / (1024.0 * 1024.0)
+              << " MB\n";
+
+    return 0;
+}
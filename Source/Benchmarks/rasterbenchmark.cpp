@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Benchmarks/benchmark.h"
+#include "Utilities/model.h"
+#include "Utilities/rasterizer.h"
+#include "Utilities/texture.h"
+#include "Utilities/tgaimage.h"
+#include "Utilities/threadpool.h"
+
+struct BenchmarkModel
+{
+    std::string Path;
+    std::string Filename;
+};
+
+struct BenchmarkBackend
+{
+    RasterizerBackend Backend;
+    bool              UseHiZ;
+    bool              IsDeferred;
+    const char*       Name;
+};
+
+std::vector<Triangle> BuildTriangles(const Model& model, int width, int height)
+{
+    float halfWidth  = width / 2.0f;
+    float halfHeight = height / 2.0f;
+
+    Span<const Vertex> vertices = model.GetWeldedVertices();
+    const IndexBuffer& indices  = model.GetIndices();
+
+    std::vector<Triangle> triangles(indices.GetSize() / 3);
+
+    for (size_t i = 0; i < triangles.size(); i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            const Vertex& vertex = vertices[indices[i * 3 + j]];
+
+            // Same mapping as the clip stage with an identity projection, for an arbitrary resolution. The backends
+            // snap the vertices to their sub-pixel grid themselves.
+            float x = (vertex.Position.x + 1.0f) * halfWidth;
+            float y = (vertex.Position.y + 1.0f) * halfHeight;
+
+            triangles[i].ScreenCoords[j] = glm::vec3(x, y, vertex.Position.z);
+            triangles[i].TexCoords[j]    = vertex.TexCoord;
+            triangles[i].Normals[j]      = vertex.Normal;
+        }
+    }
+
+    return triangles;
+}
+
+// Renders the triangles NUM_RUNS times and returns the fastest time in milliseconds
+double TimeRender(const std::vector<Triangle>& triangles, const ShadingState& shading, const BenchmarkBackend& backend,
+                  int resolution, int tileSize, ThreadPool& threadPool)
+{
+    TGAImage           image(resolution, resolution, TGAImage::RGB);
+    std::vector<float> zBuffer(static_cast<size_t>(resolution) * resolution);
+    HiZBuffer          hiZBuffer(resolution, resolution);
+    VisibilityBuffer   visibilityBuffer(resolution, resolution);
+
+    FrameBuffer frameBuffer;
+    frameBuffer.Image   = &image;
+    frameBuffer.ZBuffer = zBuffer.data();
+    frameBuffer.Width   = resolution;
+    frameBuffer.Height  = resolution;
+    frameBuffer.HiZ     = backend.UseHiZ ? &hiZBuffer : nullptr;
+
+    TileRasterizer rasterizer(resolution, resolution, tileSize);
+    rasterizer.SetBackend(backend.Backend);
+
+    auto prepare = [&]() {
+        std::fill(zBuffer.begin(), zBuffer.end(), -std::numeric_limits<float>::max());
+        hiZBuffer.Clear(-std::numeric_limits<float>::max());
+        visibilityBuffer.Clear();
+        image.clear();
+    };
+
+    return TimeBestRun(prepare, [&]() {
+        if (backend.IsDeferred)
+        {
+            rasterizer.RenderDeferred(triangles, shading, frameBuffer, visibilityBuffer, threadPool);
+        }
+        else
+        {
+            rasterizer.Render(triangles, shading, frameBuffer, threadPool);
+        }
+    });
+}
+
+int main()
+{
+    const std::vector<BenchmarkModel> models = {
+        {"../Assets/obj/african_head/", "african_head.obj"},
+        {"../Assets/obj/diablo3_pose/", "diablo3_pose.obj"},
+    };
+
+    const std::vector<int> resolutions = {1024, 4096, 8192};
+
+    const std::vector<BenchmarkBackend> backends = {
+        {RasterizerBackend::Reference, false, false, "Reference"},
+        {RasterizerBackend::Incremental, false, false, "Incremental"},
+        {RasterizerBackend::Scanline, false, false, "Scanline"},
+        {RasterizerBackend::SIMD, false, false, "SIMD"},
+        {RasterizerBackend::Hierarchical, false, false, "Hierarchical"},
+        {RasterizerBackend::SIMD, true, false, "SIMD+HiZ"},
+        {RasterizerBackend::Hierarchical, true, false, "Hier.+HiZ"},
+        {RasterizerBackend::Hierarchical, false, true, "Deferred"},
+        {RasterizerBackend::Hierarchical, true, true, "Deferred+HiZ"},
+    };
+
+    // A single thread with a single tile covering the whole screen measures the traversal order on its own, the way
+    // the original serial loop walked the buffers
+    ThreadPool singleThread(1);
+    ThreadPool allThreads;
+
+    std::cout << "SIMD backend uses " << GetSimdLevelName(GetSimdLevel()) << "\n";
+
+    for (const BenchmarkModel& benchmarkModel : models)
+    {
+        Model model(benchmarkModel.Path + benchmarkModel.Filename);
+
+        // Every batch is drawn with the texture of the first material, and with a plain white texel when that has no
+        // diffuse texture, the sampling cost is not what this benchmark is about
+        unsigned char whiteTexel[3] = {255, 255, 255};
+        Texture       whiteTexture  = {whiteTexel, 1, 1, 3};
+
+        std::string              texturePath = benchmarkModel.Path + model.GetMaterial(0).DiffuseTextureName;
+        std::shared_ptr<Texture> texture     = DecodeTexture(texturePath);
+
+        ShadingState shading;
+        shading.DiffuseTexture = texture != nullptr ? texture.get() : &whiteTexture;
+        shading.LightDirection = glm::vec3(0, 0, 1);
+
+        for (int resolution : resolutions)
+        {
+            std::vector<Triangle> triangles = BuildTriangles(model, resolution, resolution);
+
+            std::cout << "\n" << benchmarkModel.Filename << " at " << resolution << "x" << resolution << " (tiled uses "
+                      << "64px tiles on " << allThreads.GetNumThreads() << " threads)\n";
+            std::cout << std::left << std::setw(14) << "Backend" << std::right << std::setw(16) << "Serial (ms)"
+                      << std::setw(16) << "Tiled (ms)\n";
+
+            for (const BenchmarkBackend& backend : backends)
+            {
+                double serialTime = TimeRender(triangles, shading, backend, resolution, resolution, singleThread);
+                double tiledTime  = TimeRender(triangles, shading, backend, resolution, 64, allThreads);
+
+                std::cout << std::left << std::setw(14) << backend.Name << std::right << std::fixed
+                          << std::setprecision(2) << std::setw(16) << serialTime << std::setw(15) << tiledTime << "\n";
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Benchmarks/benchmark.h"
+#include "Utilities/sampler.h"
+#include "Utilities/texture.h"
+
+// How many times the texture repeats across the screen. More than once, so that the address modes all get used, and
+// not a whole number, so that trilinear filtering blends two mip levels.
+const float TEXTURE_SCALE = 1.5f;
+
+// The texture coordinates of every pixel of the screen, row by row
+struct TexCoords
+{
+    std::vector<float> U;
+    std::vector<float> V;
+};
+
+TexCoords BuildTexCoords(float angle)
+{
+    RotatedTexCoords rotated = GetRotatedTexCoords(angle, TEXTURE_SCALE);
+
+    TexCoords texCoords;
+    texCoords.U.resize(static_cast<size_t>(SCREEN_SIZE) * SCREEN_SIZE);
+    texCoords.V.resize(static_cast<size_t>(SCREEN_SIZE) * SCREEN_SIZE);
+
+    for (int y = 0; y < SCREEN_SIZE; y++)
+    {
+        for (int x = 0; x < SCREEN_SIZE; x++)
+        {
+            glm::vec2 uv = rotated.At(x, y);
+
+            texCoords.U[x + static_cast<size_t>(y) * SCREEN_SIZE] = uv.x;
+            texCoords.V[x + static_cast<size_t>(y) * SCREEN_SIZE] = uv.y;
+        }
+    }
+
+    return texCoords;
+}
+
+// Samples every pixel, either one at a time or a row at a time, and returns the fastest time in milliseconds
+double TimeSampling(const Texture& texture, const SamplerState& sampler, const TexCoords& texCoords, float lod,
+                    bool isBatched, std::vector<TGAColor>& colors)
+{
+    return TimeBestRun([&]() {
+        for (int y = 0; y < SCREEN_SIZE; y++)
+        {
+            size_t first = static_cast<size_t>(y) * SCREEN_SIZE;
+
+            if (isBatched)
+            {
+                SampleTextureBatch(texture, sampler, &texCoords.U[first], &texCoords.V[first], lod, SCREEN_SIZE,
+                                   &colors[first]);
+                continue;
+            }
+
+            for (size_t i = first; i < first + SCREEN_SIZE; i++)
+            {
+                colors[i] = SampleTexture(texture, sampler, glm::vec2(texCoords.U[i], texCoords.V[i]), lod);
+            }
+        }
+    });
+}
+
+// Compares sampling one coordinate at a time with sampling whole rows through the SIMD batches, for every filter and
+// address mode. Both have to give exactly the same colors.
+int main()
+{
+    const std::string texturePath = "../Assets/obj/african_head/african_head_diffuse.tga";
+
+    std::shared_ptr<Texture> texture = DecodeTexture(texturePath);
+    if (texture == nullptr)
+    {
+        std::cerr << "Failed to load texture " << texturePath << "\n";
+        return 1;
+    }
+    BuildMipChain(*texture);
+
+    // The footprint of a pixel is TEXTURE_SCALE texels of the full resolution level
+    float     lod       = std::log2(TEXTURE_SCALE * texture->Width / SCREEN_SIZE);
+    TexCoords texCoords = BuildTexCoords(30.0f);
+
+    const TextureFilter filters[3]     = {TextureFilter::Nearest, TextureFilter::Bilinear, TextureFilter::Trilinear};
+    const char*         filterNames[3] = {"Nearest", "Bilinear", "Trilinear"};
+
+    const TextureAddressMode addressModes[3] = {TextureAddressMode::Wrap, TextureAddressMode::Clamp,
+                                                TextureAddressMode::Mirror};
+    const char*              addressModeNames[3] = {"Wrap", "Clamp", "Mirror"};
+
+    std::vector<TGAColor> colors(texCoords.U.size());
+    std::vector<TGAColor> batchedColors(texCoords.U.size());
+
+    std::cout << "\nSampling " << texturePath << " at " << SCREEN_SIZE << "x" << SCREEN_SIZE << " pixels, "
+              << SAMPLE_BATCH_SIZE << " coordinates per batch\n";
+    std::cout << std::left << std::setw(12) << "Filter" << std::setw(10) << "Address" << std::right << std::setw(16)
+              << "Single (ms)" << std::setw(16) << "Batched (ms)" << std::setw(12) << "Speedup\n";
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            SamplerState sampler = {filters[i], addressModes[j]};
+
+            double singleTime  = TimeSampling(*texture, sampler, texCoords, lod, false, colors);
+            double batchedTime = TimeSampling(*texture, sampler, texCoords, lod, true, batchedColors);
+
+            std::cout << std::left << std::setw(12) << filterNames[i] << std::setw(10) << addressModeNames[j]
+                      << std::right << std::fixed << std::setprecision(2) << std::setw(16) << singleTime
+                      << std::setw(16) << batchedTime << std::setw(10) << singleTime / batchedTime << "x";
+
+            for (size_t pixel = 0; pixel < colors.size(); pixel++)
+            {
+                if (std::memcmp(colors[pixel].bgra, batchedColors[pixel].bgra, 3) != 0)
+                {
+                    std::cout << "  (the batches sampled different colors)";
+                    break;
+                }
+            }
+            std::cout << "\n";
+        }
+    }
+
+    return 0;
+}
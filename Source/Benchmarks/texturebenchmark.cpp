@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Benchmarks/benchmark.h"
+#include "Utilities/sampler.h"
+#include "Utilities/texture.h"
+
+// Samples the texture over the whole screen, walking the pixels row by row the way the rasterizers do, with the
+// texture rotated by angle and scaled by scale as GetRotatedTexCoords does.
+//
+// Returns the time in milliseconds, and adds the sampled colors to checksum so that the compiler can't skip any of the
+// sampling.
+double TimeSampling(const Texture& texture, const SamplerState& sampler, float angle, float scale,
+                    std::uint64_t& checksum)
+{
+    RotatedTexCoords texCoords = GetRotatedTexCoords(angle, scale);
+
+    return TimeBestRun([&]() {
+        std::uint64_t sum = 0;
+        for (int y = 0; y < SCREEN_SIZE; y++)
+        {
+            for (int x = 0; x < SCREEN_SIZE; x++)
+            {
+                TGAColor color = SampleTexture(texture, sampler, texCoords.At(x, y), 0.0f);
+                sum += color[0] + color[1] + color[2];
+            }
+        }
+        checksum += sum;
+    });
+}
+
+// The peak signal to noise ratio of the colors of a compressed texture, in dB, taken texel by texel against the
+// original. Above about 40 the difference is hard to see.
+double ComputePsnr(const Texture& original, const Texture& compressed)
+{
+    const SamplerState sampler = {TextureFilter::Nearest, TextureAddressMode::Clamp};
+
+    double squaredError = 0.0;
+    for (int y = 0; y < original.Height; y++)
+    {
+        for (int x = 0; x < original.Width; x++)
+        {
+            glm::vec2 uv((x + 0.5f) / original.Width, (y + 0.5f) / original.Height);
+            TGAColor  expected = SampleTexture(original, sampler, uv, 0.0f);
+            TGAColor  actual   = SampleTexture(compressed, sampler, uv, 0.0f);
+
+            for (int component = 0; component < 3; component++)
+            {
+                double difference = static_cast<double>(expected[component]) - actual[component];
+                squaredError += difference * difference;
+            }
+        }
+    }
+
+    double meanSquaredError = squaredError / (3.0 * original.Width * original.Height);
+    return 10.0 * std::log10(255.0 * 255.0 / std::max(meanSquaredError, 1e-10));
+}
+
+// Compares sampling a texture stored row by row with sampling the same texture stored in tiles, and compressed, for
+// different directions of walking over it, and for a texture magnified about 1:1 or minified without any mip levels.
+// The first two layouts sample the exact same colors, so their checksums have to match. The compressed one only comes
+// close, and takes a fraction of the memory.
+int main()
+{
+    const std::string texturePath = "../Assets/obj/african_head/african_head_diffuse.tga";
+
+    std::shared_ptr<Texture> rowMajor   = DecodeTexture(texturePath, TextureLayout::RowMajor);
+    std::shared_ptr<Texture> tiled      = DecodeTexture(texturePath, TextureLayout::Tiled);
+    std::shared_ptr<Texture> compressed = DecodeTexture(texturePath, TextureLayout::Compressed);
+
+    if (rowMajor == nullptr || tiled == nullptr || compressed == nullptr)
+    {
+        std::cerr << "Failed to load texture " << texturePath << "\n";
+        return 1;
+    }
+
+    const std::vector<float> angles         = {0.0f, 30.0f, 45.0f, 90.0f};
+    const std::vector<float> scales         = {1.0f, 4.0f};
+    const SamplerState       samplers[2]    = {{TextureFilter::Nearest}, {TextureFilter::Bilinear}};
+    const char*              filterNames[2] = {"Nearest", "Bilinear"};
+
+    std::cout << "\nSampling " << texturePath << " (" << rowMajor->Width << "x" << rowMajor->Height << ") at "
+              << SCREEN_SIZE << "x" << SCREEN_SIZE << " pixels, tiles of " << TEXTURE_TILE_SIZE << "x"
+              << TEXTURE_TILE_SIZE << "\n";
+    std::cout << "Memory: " << GetTextureMemorySize(*rowMajor) / 1024 << " KB row major, "
+              << GetTextureMemorySize(*tiled) / 1024 << " KB tiled, " << GetTextureMemorySize(*compressed) / 1024
+              << " KB compressed, at " << std::fixed << std::setprecision(2) << ComputePsnr(*rowMajor, *compressed)
+              << " dB PSNR\n";
+    std::cout << std::left << std::setw(12) << "Filter" << std::setw(8) << "Angle" << std::setw(8) << "Scale"
+              << std::right << std::setw(18) << "Row major (ms)" << std::setw(14) << "Tiled (ms)" << std::setw(12)
+              << "Speedup" << std::setw(19) << "Compressed (ms)" << std::setw(12) << "Speedup\n";
+
+    for (int i = 0; i < 2; i++)
+    {
+        for (float scale : scales)
+        {
+            for (float angle : angles)
+            {
+                std::uint64_t rowMajorChecksum   = 0;
+                std::uint64_t tiledChecksum      = 0;
+                std::uint64_t compressedChecksum = 0;
+
+                double rowMajorTime   = TimeSampling(*rowMajor, samplers[i], angle, scale, rowMajorChecksum);
+                double tiledTime      = TimeSampling(*tiled, samplers[i], angle, scale, tiledChecksum);
+                double compressedTime = TimeSampling(*compressed, samplers[i], angle, scale, compressedChecksum);
+
+                std::cout << std::left << std::setw(12) << filterNames[i] << std::setw(8) << static_cast<int>(angle)
+                          << std::setw(8) << static_cast<int>(scale) << std::right << std::fixed << std::setprecision(2)
+                          << std::setw(18) << rowMajorTime << std::setw(14) << tiledTime << std::setw(11)
+                          << rowMajorTime / tiledTime << "x" << std::setw(19) << compressedTime << std::setw(11)
+                          << rowMajorTime / compressedTime << "x";
+
+                if (rowMajorChecksum != tiledChecksum)
+                {
+                    std::cout << "  (the layouts sampled different colors)";
+                }
+                std::cout << "\n";
+            }
+        }
+    }
+
+    return 0;
+}
@@ -2,12 +2,16 @@
 #include <iostream>
 #include <vector>
 
-#define STB_IMAGE_IMPLEMENTATION
 #include <GLFW/glfw3.h>
-#include <stb_image/stb_image.h>
 
+#include "Utilities/assetloader.h"
+#include "Utilities/clipping.h"
 #include "Utilities/model.h"
+#include "Utilities/rasterizer.h"
+#include "Utilities/texturecache.h"
 #include "Utilities/tgaimage.h"
+#include "Utilities/threadpool.h"
+#include "Utilities/vertexprocessing.h"
 #include "glm/fwd.hpp"
 #include "glm/geometric.hpp"
 
@@ -19,119 +23,8 @@ const TGAColor WHITE = TGAColor(255, 255, 255);
 const float HALF_WIDTH  = WIDTH / 2.0f;
 const float HALF_HEIGHT = HEIGHT / 2.0f;
 
-float EdgeFunctionCW(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
-{
-    return (c.x - a.x) * (b.y - a.y) - (c.y - a.y) * (b.x - a.x);
-}
-float EdgeFunctionCCW(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
-{
-    return (a.x - b.x) * (c.y - a.y) - (a.y - b.y) * (c.x - a.x);
-}
-
-TGAColor GetPixelColor(const Texture& texture, const glm::vec2& uv)
-{
-    int x = static_cast<int>(uv.x * texture.Width);
-    int y = static_cast<int>(uv.y * texture.Height);
-
-    unsigned char* pixelOffset = texture.Data + (x + texture.Width * y) * texture.NumComponents;
-
-    return TGAColor(pixelOffset[0], pixelOffset[1], pixelOffset[2]);
-}
-
-struct Color
-{
-    int R;
-    int G;
-    int B;
-};
-
-void DrawTriangle(const glm::vec3 vertices[3], const glm::vec2 uvs[3], const glm::vec3 normals[3],
-                  const Texture& texture, float* zbuffer, TGAImage& image, const glm::vec3& lightDirection)
-{
-
-    float area = EdgeFunctionCCW(vertices[0], vertices[1], vertices[2]);
-
-    // An area of 0 means that the triangle is degenerate, so does not need to be rendered
-    if (area == 0)
-    {
-        return;
-    }
-
-    glm::vec2 bboxMin(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
-    glm::vec2 bboxMax(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
-
-    // clamping the bounding box of the triangle to the edges of the screen.
-    glm::vec2 clamp(image.get_width() - 1, image.get_height() - 1);
-
-    for (int i = 0; i < 3; i++)
-    {
-        for (int j = 0; j < 2; j++)
-        {
-            bboxMin[j] = std::max(0.0f, std::min(bboxMin[j], vertices[i][j]));
-            bboxMax[j] = std::min(clamp[j], std::max(bboxMax[j], vertices[i][j]));
-        }
-    }
-
-    glm::vec3 point;
-    TGAColor  color;
-    glm::vec2 texCoord;
-    glm::vec3 normal;
-    float     lightIntensity;
-
-    // Loop throught all the pixels within the bounding box
-    for (point.x = bboxMin.x; point.x <= bboxMax.x; point.x++)
-    {
-        for (point.y = bboxMin.y; point.y <= bboxMax.y; point.y++)
-        {
-
-            // for each weigth, we take the edge function of the edge opposite it
-            float w0 = EdgeFunctionCCW(vertices[1], vertices[2], point);
-            float w1 = EdgeFunctionCCW(vertices[2], vertices[0], point);
-            float w2 = EdgeFunctionCCW(vertices[0], vertices[1], point);
-
-            // if point p is inside triangles defined by vertices v0, v1, v2
-            if (w0 <= 0 && w1 <= 0 && w2 <= 0)
-            {
-                // barycentric coordinates are the areas of the sub-triangles divided by the area of the main triangle
-                w0 /= area;
-                w1 /= area;
-                w2 /= area;
-
-                // interpolating using the barycentric coordinated to find the z value of the pixel
-                point.z = vertices[0].z * w0 + vertices[1].z * w1 + vertices[2].z * w2;
-
-                // if the z value of the current pixel is more than the value store in the zBuffer, we draw the
-                // pixel and set the new value of the zBuffer at the current pixel
-                if (zbuffer[int(point.x + point.y * WIDTH)] < point.z)
-                {
-                    // Updating the zBuffer to hold the depth value of the current pixel
-                    zbuffer[int(point.x + point.y * WIDTH)] = point.z;
-
-                    // finding the fragment normal by interpolating the barycentric coordinates
-                    normal = glm::normalize(normals[0] * w0 + normals[1] * w1 + normals[2] * w2);
-
-                    // If the angle between normal and light direction is more than 90 (i.e. the light does not
-                    // illuinate the surface), then the dot product will be less than 0
-                    float lightIntensity = glm::dot(lightDirection, normal);
-
-                    // If fragment is not illuminated, then don't draw it
-                    if (lightIntensity > 0)
-                    {
-                        // Finding the diffuse texture coordinates by interpolating the vertex texCoords using
-                        // barycentric coordinates
-                        texCoord = uvs[0] * w0 + uvs[1] * w1 + uvs[2] * w2;
-
-                        // Changing the brightness of the pixel based on the light intensity
-                        color = GetPixelColor(texture, texCoord) * lightIntensity;
-
-                        // Draw the pixel
-                        image.set(point.x, point.y, color);
-                    }
-                }
-            }
-        }
-    }
-}
+// How much memory the decoded textures can keep taking up between renders
+const size_t TEXTURE_CACHE_BUDGET = 256 * 1024 * 1024;
 
 void DrawLine(int x0, int y0, int x1, int y1, TGAImage& image, TGAColor color)
 {
@@ -172,14 +65,6 @@ void DrawLine(int x0, int y0, int x1, int y1, TGAImage& image, TGAColor color)
     }
 }
 
-glm::vec3 WorldToScreen(const glm::vec3& vec)
-{
-    int x = static_cast<int>((vec.x + 1.0f) * HALF_WIDTH + 0.5f);
-    int y = static_cast<int>((vec.y + 1.0f) * HALF_HEIGHT + 0.5f);
-
-    return glm::vec3(x, y, vec.z);
-}
-
 glm::vec3 CalculateSurfaceNormal(const glm::vec3* const vertices)
 {
     glm::vec3 u = vertices[2] - vertices[0];
@@ -188,27 +73,31 @@ glm::vec3 CalculateSurfaceNormal(const glm::vec3* const vertices)
     return glm::normalize(glm::cross(u, v));
 }
 
-void RenderModel(const std::string& path, const std::string& filename, const std::string& ouputName)
+void RenderModel(const ModelAsset& asset, const std::string& ouputName, ThreadPool& threadPool)
 {
-    Model* model = new Model(path + filename);
+    const Model* model = asset.Mesh.get();
 
     TGAImage wireframeImage(WIDTH, HEIGHT, TGAImage::RGB);
     TGAImage renderImage(WIDTH, HEIGHT, TGAImage::RGB);
     TGAImage depthBufferImage(WIDTH, HEIGHT, TGAImage::RGB);
+    TGAImage normalImage(WIDTH, HEIGHT, TGAImage::RGB);
 
-    Material material = model->GetMaterial();
+    // One texture per material, which may still be decoding. Materials without a texture get a single white texel.
+    static unsigned char white[3]     = {255, 255, 255};
+    static Texture       whiteTexture = {white, 1, 1, 3};
 
-    // Texture Loading
-    stbi_set_flip_vertically_on_load(true);
+    std::vector<std::shared_ptr<Texture>> textures(model->GetNumMaterials());
+    for (int i = 0; i < model->GetNumMaterials(); i++)
+    {
+        const Material& material = model->GetMaterial(i);
 
-    Texture texture;
-    texture.Data = stbi_load(std::string(path + material.DiffuseTextureName).c_str(), &texture.Width, &texture.Height,
-                             &texture.NumComponents, 0);
+        textures[i] = asset.DiffuseTextures[i].get();
 
-    if (texture.Data == NULL)
-    {
-        std::cerr << "Failed to load texture " << material.DiffuseTextureName << "\n";
-        return;
+        if (textures[i] == nullptr && !material.DiffuseTextureName.empty())
+        {
+            std::cerr << "Failed to load texture " << material.DiffuseTextureName << "\n";
+            return;
+        }
     }
 
     // Initialize the zBuffer and set all values to negative infinity
@@ -219,39 +108,95 @@ void RenderModel(const std::string& path, const std::string& filename, const std
         zBuffer[i] = -std::numeric_limits<float>::max();
     }
 
-    glm::vec3 lightDirection(0, 0, 1);
-
-    // Loop through all triangles
-    for (int i = 0; i < model->GetNumFaces(); i++)
+    std::vector<ShadingState> shadings(model->GetNumMaterials());
+    for (int i = 0; i < model->GetNumMaterials(); i++)
     {
-        Face face = model->GetFaceAtIndex(i);
+        shadings[i].DiffuseTexture = textures[i] != nullptr ? textures[i].get() : &whiteTexture;
+        shadings[i].LightDirection = glm::vec3(0, 0, 1);
+        shadings[i].Sampler        = {TextureFilter::Trilinear, TextureAddressMode::Wrap};
+    }
 
-        glm::vec3 vertices[3];
-        glm::vec3 normals[3];
-        glm::vec2 uvs[3];
+    // The models are already in [-1, 1], so the identity leaves them as they are. A perspective projection only needs
+    // to map the near plane to z = w and the far plane to z = -w, the clip stage takes care of the rest.
+    glm::mat4 projection(1.0f);
 
-        glm::vec3 screenCoords[3];
+    // The loader already optimized the mesh, this is what that did
+    const MeshOptimizationStats& optimizationStats = model->GetOptimizationStats();
 
+    std::cout << ouputName << ": ACMR " << optimizationStats.Before.ACMR << " -> " << optimizationStats.After.ACMR
+              << ", ATVR " << optimizationStats.Before.ATVR << " -> " << optimizationStats.After.ATVR << "\n";
+
+    // Transform every vertex once, then put the triangles together from the transformed vertices
+    std::vector<glm::vec4>    clipPositions;
+    std::vector<ClipTriangle> clipTriangles;
+    TransformVerticesSoA(model->GetSoAVertices(), projection, clipPositions, threadPool);
+    AssembleTrianglesSoA(*model, clipPositions, clipTriangles, threadPool);
+
+    // Draw the wireframe straight from the model
+    for (const Face& face : model->GetFaces())
+    {
         for (int j = 0; j < 3; j++)
         {
-            vertices[j] = model->GetVertexAtIndex(face[j].VertexIndex);
-            uvs[j]      = model->GetTexCoordAtIndex(face[j].TexCoordIndex);
-            normals[j]  = model->GetNormalAtIndex(face[j].NormalIndex);
-
-            screenCoords[j] = WorldToScreen(vertices[j]);
-
-            glm::vec3 v0 = vertices[j];
-            glm::vec3 v1 = model->GetVertexAtIndex(face[(j + 1) % 3].VertexIndex);
-            int       x0 = (v0.x + 1.0f) * HALF_WIDTH;
-            int       y0 = (v0.y + 1.0f) * HALF_HEIGHT;
-            int       x1 = (v1.x + 1.0f) * HALF_WIDTH;
-            int       y1 = (v1.y + 1.0f) * HALF_HEIGHT;
+            const glm::vec3& v0 = model->GetVertices()[face[j].VertexIndex];
+            const glm::vec3& v1 = model->GetVertices()[face[(j + 1) % 3].VertexIndex];
+            int              x0 = (v0.x + 1.0f) * HALF_WIDTH;
+            int              y0 = (v0.y + 1.0f) * HALF_HEIGHT;
+            int              x1 = (v1.x + 1.0f) * HALF_WIDTH;
+            int              y1 = (v1.y + 1.0f) * HALF_HEIGHT;
             DrawLine(x0, y0, x1, y1, wireframeImage, WHITE * ((v0.z + 1) / 2));
         }
+    }
+
+    // Clip against the near and far planes and the guard band, and map what is left to the screen. Clipping can add
+    // and remove triangles, so the batches are clipped one by one to know where each one ends up.
+    std::vector<Triangle>     triangles;
+    std::vector<ShadingBatch> shadingBatches;
+    ClipStats                 clipStats;
+    triangles.reserve(clipTriangles.size());
 
-        DrawTriangle(screenCoords, uvs, normals, texture, zBuffer, renderImage, lightDirection);
+    for (const DrawBatch& batch : model->GetDrawBatches())
+    {
+        int firstTriangle = static_cast<int>(triangles.size());
+
+        Span<const ClipTriangle> batchTriangles(clipTriangles.data() + batch.FirstFace, batch.NumFaces);
+        ClipTriangles(batchTriangles, WIDTH, HEIGHT, triangles, clipStats);
+
+        int numTriangles = static_cast<int>(triangles.size()) - firstTriangle;
+        shadingBatches.push_back({firstTriangle, numTriangles, &shadings[batch.MaterialIndex]});
     }
 
+    // The Hi-Z buffer starts out with the same depth as the zBuffer
+    HiZBuffer hiZBuffer(WIDTH, HEIGHT);
+    hiZBuffer.Clear(-std::numeric_limits<float>::max());
+
+    FrameBuffer frameBuffer;
+    frameBuffer.Image   = &renderImage;
+    frameBuffer.ZBuffer = zBuffer;
+    frameBuffer.Width   = WIDTH;
+    frameBuffer.Height  = HEIGHT;
+    frameBuffer.HiZ     = &hiZBuffer;
+
+    // Starts out empty, like the zBuffer
+    VisibilityBuffer visibilityBuffer(WIDTH, HEIGHT);
+
+    // Rasterize the triangles tile by tile, spread over all the threads of the pool. Every tile first resolves which
+    // triangle is visible at each pixel, then shades each covered pixel exactly once, with the material of its batch.
+    TileRasterizer rasterizer(WIDTH, HEIGHT);
+    rasterizer.RenderDeferred(triangles, shadingBatches, frameBuffer, visibilityBuffer, threadPool);
+
+    std::cout << ouputName << ": rejected " << clipStats.NumRejected << " and clipped " << clipStats.NumClipped
+              << " of " << clipStats.NumTriangles << " triangles\n";
+
+    const CullStats& cullStats = rasterizer.GetCullStats();
+    std::cout << ouputName << ": culled " << cullStats.GetNumCulled() << " of " << cullStats.NumTriangles
+              << " triangles (" << cullStats.NumBackFacing << " back facing, " << cullStats.NumDegenerate
+              << " degenerate)\n";
+
+    // The visibility buffer can be resolved again without touching the geometry, here into the normals of the model
+    threadPool.ParallelFor(HEIGHT, [&](int y) {
+        visibilityBuffer.ResolveNormal(triangles, normalImage, PixelRect{0, y, WIDTH - 1, y});
+    });
+
     // Render the zBuffer
     for (size_t x = 0; x < WIDTH; x++)
     {
@@ -268,18 +213,68 @@ void RenderModel(const std::string& path, const std::string& filename, const std
     std::string wireframeOutputPath = "../Renders/Lesson4/" + ouputName + "Wireframe.tga";
     std::string depthBufferPath     = "../Renders/Lesson4/" + ouputName + "DepthBuffer.tga";
     std::string renderOutputPath    = "../Renders/Lesson4/" + ouputName + "Render.tga";
+    std::string normalsOutputPath   = "../Renders/Lesson4/" + ouputName + "Normals.tga";
 
     wireframeImage.write_tga_file(wireframeOutputPath);
     renderImage.write_tga_file(renderOutputPath);
     depthBufferImage.write_tga_file(depthBufferPath);
+    normalImage.write_tga_file(normalsOutputPath);
 
-    delete model;
+    delete[] zBuffer;
+}
+
+// The textures come from the cache, so rendering the models again doesn't decode them again
+void RenderModels(ThreadPool& threadPool, TextureCache& textureCache)
+{
+    struct ModelToRender
+    {
+        std::string Path;
+        std::string Filename;
+        std::string OutputName;
+    };
+
+    const std::vector<ModelToRender> models = {
+        {"../Assets/obj/african_head/", "african_head.obj", "Head"},
+        {"../Assets/obj/diablo3_pose/", "diablo3_pose.obj", "Diablo"},
+        {"../Assets/obj/Gun/", "Gun.obj", "Gun"},
+    };
+
+    // Start loading everything before rendering anything, so that the later models and all the textures load in the
+    // background while the first ones render
+    AssetLoader                                 assetLoader(threadPool, textureCache);
+    std::vector<std::shared_future<ModelAsset>> assets;
+
+    // Reorder the triangles while loading, so the vertex stage gets to reuse recently transformed vertices and so that
+    // the near side of the model is drawn first and the far side mostly fails the depth test. The SoA layout lets the
+    // transform work on several vertices at once.
+    ModelLoadOptions modelOptions;
+    modelOptions.OptimizeMesh                 = true;
+    modelOptions.Optimization.SortFrontToBack = true;
+    modelOptions.BuildSoALayout               = true;
+    assetLoader.SetModelLoadOptions(modelOptions);
+
+    for (const ModelToRender& model : models)
+    {
+        assets.push_back(assetLoader.LoadModelWithTextures(model.Path, model.Filename));
+    }
+
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        RenderModel(assets[i].get(), models[i].OutputName, threadPool);
+    }
+
+    TextureCacheStats stats = textureCache.GetStats();
+    std::cout << "Texture cache: " << stats.Hits << " hits, " << stats.Misses << " misses, " << stats.Evictions
+              << " evictions, " << stats.NumTextures << " textures taking " << stats.MemoryUsed / (1024 * 1024)
+              << " MB\n";
 }
 
 int main()
 {
     GLFWwindow* window;
 
+    ThreadPool threadPool;
+
     if (!glfwInit())
     {
         std::cout << "Could not initialize GLFW!\n";
@@ -315,9 +310,8 @@ int main()
         glfwPollEvents();
     }
 
-    // RenderModel("../Assets/obj/african_head/", "african_head.obj", "Head");
-    // RenderModel("../Assets/obj/diablo3_pose/diablo3_pose.obj", "Diablo");
-    // RenderModel("../Assets/obj/Gun/", "Gun.obj", "Gun");
+    // TextureCache textureCache(threadPool, TEXTURE_CACHE_BUDGET);
+    // RenderModels(threadPool, textureCache);
 
     glfwTerminate();
     return 0;
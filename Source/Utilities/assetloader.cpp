@@ -0,0 +1,88 @@
+#include "assetloader.h"
+
+#include <unordered_map>
+
+#include "Utilities/texturecache.h"
+#include "Utilities/threadpool.h"
+
+AssetLoader::AssetLoader(ThreadPool& threadPool, TextureLayout textureLayout)
+    : m_ThreadPool(threadPool), m_TextureLayout(textureLayout)
+{
+}
+
+AssetLoader::AssetLoader(ThreadPool& threadPool, TextureCache& textureCache)
+    : m_ThreadPool(threadPool), m_TextureLayout(TextureLayout::RowMajor), m_TextureCache(&textureCache)
+{
+}
+
+AssetHandle<Model> AssetLoader::LoadModel(const std::string& filename) const
+{
+    ThreadPool& threadPool = m_ThreadPool;
+
+    // The parser spreads the file over the pool as well, from within the task
+    return m_ThreadPool
+        .Submit([filename, &threadPool, options = m_ModelLoadOptions]() {
+            return std::make_shared<Model>(filename, threadPool, options);
+        })
+        .share();
+}
+
+AssetHandle<Texture> AssetLoader::LoadTexture(const std::string& filename) const
+{
+    if (m_TextureCache != nullptr)
+    {
+        return m_TextureCache->Load(filename);
+    }
+
+    return m_ThreadPool
+        .Submit([filename, layout = m_TextureLayout]() {
+            std::shared_ptr<Texture> texture = DecodeTexture(filename, layout);
+            if (texture != nullptr)
+            {
+                BuildMipChain(*texture);
+            }
+            return texture;
+        })
+        .share();
+}
+
+std::shared_future<ModelAsset> AssetLoader::LoadModelWithTextures(const std::string& path,
+                                                                  const std::string& filename) const
+{
+    ThreadPool& threadPool = m_ThreadPool;
+
+    // The task gets a copy of the loader, which can go away before the task runs
+    return m_ThreadPool
+        .Submit([path, filename, &threadPool, loader = *this]() {
+            ModelAsset asset;
+            asset.Mesh = std::make_shared<Model>(path + filename, threadPool, loader.m_ModelLoadOptions);
+
+            std::promise<std::shared_ptr<Texture>> noTexture;
+            noTexture.set_value(nullptr);
+            AssetHandle<Texture> noTextureHandle = noTexture.get_future().share();
+
+            // The textures get tasks of their own rather than being decoded here, so that they decode in parallel and
+            // the model can be used before they are done. Materials sharing a texture share its handle.
+            std::unordered_map<std::string, AssetHandle<Texture>> textures;
+
+            for (const Material& material : asset.Mesh->GetMaterials())
+            {
+                if (material.DiffuseTextureName.empty())
+                {
+                    asset.DiffuseTextures.push_back(noTextureHandle);
+                    continue;
+                }
+
+                auto found = textures.find(material.DiffuseTextureName);
+                if (found == textures.end())
+                {
+                    AssetHandle<Texture> texture = loader.LoadTexture(path + material.DiffuseTextureName);
+                    found = textures.emplace(material.DiffuseTextureName, texture).first;
+                }
+                asset.DiffuseTextures.push_back(found->second);
+            }
+
+            return asset;
+        })
+        .share();
+}
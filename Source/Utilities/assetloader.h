@@ -0,0 +1,62 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Utilities/model.h"
+#include "Utilities/texture.h"
+
+class TextureCache;
+class ThreadPool;
+
+// An asset that is loading in the background. Getting it waits until it is ready, and every copy of the handle gets
+// the same asset.
+template <typename Asset>
+using AssetHandle = std::shared_future<std::shared_ptr<Asset>>;
+
+// A model along with the diffuse textures of its materials
+struct ModelAsset
+{
+    std::shared_ptr<Model> Mesh;
+    // One per material, in the same order. The handles of materials without a diffuse texture, or whose texture
+    // can't be read, hold nullptr.
+    std::vector<AssetHandle<Texture>> DiffuseTextures;
+};
+
+// Loads models and textures on the workers of a thread pool, and hands out handles to them straight away. Loading a
+// whole list of assets up front lets the parsing and decoding of all of them overlap, and whoever renders them only
+// waits when it gets to an asset that isn't ready yet.
+//
+// The loader only keeps a reference to the pool, which has to outlive the loading, so it can go away before the
+// assets it started loading are ready.
+class AssetLoader
+{
+
+  public:
+    // Textures are laid out in memory with textureLayout as they are decoded
+    AssetLoader(ThreadPool& threadPool, TextureLayout textureLayout = TextureLayout::RowMajor);
+
+    // Gets every texture from the cache, which decodes them with its own layout. The cache has to outlive the loading.
+    AssetLoader(ThreadPool& threadPool, TextureCache& textureCache);
+
+    // What every model loaded from now on does once it is loaded, such as optimizing its mesh. Done on the loading
+    // thread, so the models are ready to use as they are and nobody has to modify one that others may be using.
+    inline void SetModelLoadOptions(const ModelLoadOptions& options) { m_ModelLoadOptions = options; }
+
+    AssetHandle<Model> LoadModel(const std::string& filename) const;
+
+    // Decodes the texture and builds its mip chain
+    AssetHandle<Texture> LoadTexture(const std::string& filename) const;
+
+    // Loads the model, then starts loading the diffuse textures of its materials from the directory path, which ends
+    // with a separator. The model is ready before its textures are, each texture can be waited for on its own.
+    std::shared_future<ModelAsset> LoadModelWithTextures(const std::string& path, const std::string& filename) const;
+
+  private:
+    ThreadPool&      m_ThreadPool;
+    TextureLayout    m_TextureLayout;
+    TextureCache*    m_TextureCache = nullptr;
+    ModelLoadOptions m_ModelLoadOptions;
+};
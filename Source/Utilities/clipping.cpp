@@ -0,0 +1,218 @@
+#include "clipping.h"
+
+#include <algorithm>
+
+#include "Utilities/rasterizer.h"
+
+// The planes triangles get clipped against, each one given as the dot product with the clip space position that is
+// >= 0 on the visible side
+enum ClipPlane
+{
+    CLIP_NEAR,
+    CLIP_FAR,
+    CLIP_W,
+    CLIP_GUARD_LEFT,
+    CLIP_GUARD_RIGHT,
+    CLIP_GUARD_BOTTOM,
+    CLIP_GUARD_TOP,
+    NUM_CLIP_PLANES
+};
+
+// Outcode bits of a vertex. The first ones match the clip planes, the others are the sides of the screen, which are
+// only used to reject triangles and never to clip them.
+enum Outcode
+{
+    OUTSIDE_NEAR         = 1 << CLIP_NEAR,
+    OUTSIDE_FAR          = 1 << CLIP_FAR,
+    OUTSIDE_W            = 1 << CLIP_W,
+    OUTSIDE_GUARD_LEFT   = 1 << CLIP_GUARD_LEFT,
+    OUTSIDE_GUARD_RIGHT  = 1 << CLIP_GUARD_RIGHT,
+    OUTSIDE_GUARD_BOTTOM = 1 << CLIP_GUARD_BOTTOM,
+    OUTSIDE_GUARD_TOP    = 1 << CLIP_GUARD_TOP,
+    OUTSIDE_LEFT         = 1 << NUM_CLIP_PLANES,
+    OUTSIDE_RIGHT        = 1 << (NUM_CLIP_PLANES + 1),
+    OUTSIDE_BOTTOM       = 1 << (NUM_CLIP_PLANES + 2),
+    OUTSIDE_TOP          = 1 << (NUM_CLIP_PLANES + 3),
+
+    CLIP_PLANE_BITS = (1 << NUM_CLIP_PLANES) - 1
+};
+
+// Vertices closer than this to w = 0 would blow up when divided by w
+const float W_EPSILON = 1e-5f;
+
+// A triangle clipped by all the planes ends up with at most 3 + NUM_CLIP_PLANES vertices
+const int MAX_POLYGON_VERTICES = 3 + NUM_CLIP_PLANES;
+
+struct GuardBand
+{
+    float X;
+    float Y;
+};
+
+static float GetPlaneDistance(const glm::vec4& position, int plane, const GuardBand& guardBand)
+{
+    switch (plane)
+    {
+    case CLIP_NEAR:
+        return position.w - position.z;
+    case CLIP_FAR:
+        return position.w + position.z;
+    case CLIP_W:
+        return position.w - W_EPSILON;
+    case CLIP_GUARD_LEFT:
+        return position.x + guardBand.X * position.w;
+    case CLIP_GUARD_RIGHT:
+        return guardBand.X * position.w - position.x;
+    case CLIP_GUARD_BOTTOM:
+        return position.y + guardBand.Y * position.w;
+    default:
+        return guardBand.Y * position.w - position.y;
+    }
+}
+
+static int GetOutcode(const glm::vec4& position, const GuardBand& guardBand)
+{
+    int outcode = 0;
+
+    for (int plane = 0; plane < NUM_CLIP_PLANES; plane++)
+    {
+        if (GetPlaneDistance(position, plane, guardBand) < 0)
+        {
+            outcode |= 1 << plane;
+        }
+    }
+
+    outcode |= position.x < -position.w ? OUTSIDE_LEFT : 0;
+    outcode |= position.x > position.w ? OUTSIDE_RIGHT : 0;
+    outcode |= position.y < -position.w ? OUTSIDE_BOTTOM : 0;
+    outcode |= position.y > position.w ? OUTSIDE_TOP : 0;
+
+    return outcode;
+}
+
+static ClipVertex Lerp(const ClipVertex& a, const ClipVertex& b, float t)
+{
+    ClipVertex result;
+    result.Position = a.Position + (b.Position - a.Position) * t;
+    result.TexCoord = a.TexCoord + (b.TexCoord - a.TexCoord) * t;
+    result.Normal   = a.Normal + (b.Normal - a.Normal) * t;
+
+    return result;
+}
+
+// Clips the polygon against a single plane, keeping the part on its visible side. Returns the new number of vertices.
+static int ClipPolygon(const ClipVertex* input, int numVertices, ClipVertex* output, int plane,
+                       const GuardBand& guardBand)
+{
+    int numOutput = 0;
+
+    for (int i = 0; i < numVertices; i++)
+    {
+        const ClipVertex& current = input[i];
+        const ClipVertex& next    = input[(i + 1) % numVertices];
+
+        float currentDistance = GetPlaneDistance(current.Position, plane, guardBand);
+        float nextDistance    = GetPlaneDistance(next.Position, plane, guardBand);
+
+        if (currentDistance >= 0)
+        {
+            output[numOutput++] = current;
+        }
+
+        // The edge crosses the plane, so add the point where it does
+        if ((currentDistance >= 0) != (nextDistance >= 0))
+        {
+            float t             = currentDistance / (currentDistance - nextDistance);
+            output[numOutput++] = Lerp(current, next, t);
+        }
+    }
+
+    return numOutput;
+}
+
+static void ProjectTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, float halfWidth,
+                            float halfHeight, Triangle& triangle)
+{
+    const ClipVertex* vertices[3] = {&v0, &v1, &v2};
+
+    for (int i = 0; i < 3; i++)
+    {
+        const glm::vec4& position = vertices[i]->Position;
+        float            inverseW = 1.0f / position.w;
+
+        // From [-1, 1] to [0, width] and [0, height], keeping the depth as is
+        triangle.ScreenCoords[i] = glm::vec3((position.x * inverseW + 1.0f) * halfWidth,
+                                             (position.y * inverseW + 1.0f) * halfHeight, position.z * inverseW);
+        triangle.TexCoords[i] = vertices[i]->TexCoord;
+        triangle.Normals[i]   = vertices[i]->Normal;
+    }
+}
+
+void ClipTriangles(Span<const ClipTriangle> triangles, int width, int height, std::vector<Triangle>& output,
+                   ClipStats& stats)
+{
+    float halfWidth  = width / 2.0f;
+    float halfHeight = height / 2.0f;
+
+    // The guard band in clip space, as a multiple of w
+    GuardBand guardBand;
+    guardBand.X = 1.0f + GUARD_BAND_PIXELS / halfWidth;
+    guardBand.Y = 1.0f + GUARD_BAND_PIXELS / halfHeight;
+
+    stats.NumTriangles += static_cast<int>(triangles.size());
+
+    for (const ClipTriangle& triangle : triangles)
+    {
+        const ClipVertex* vertices = triangle.Vertices;
+
+        int outcode0 = GetOutcode(vertices[0].Position, guardBand);
+        int outcode1 = GetOutcode(vertices[1].Position, guardBand);
+        int outcode2 = GetOutcode(vertices[2].Position, guardBand);
+
+        // All three vertices are on the outer side of the same plane
+        if ((outcode0 & outcode1 & outcode2) != 0)
+        {
+            stats.NumRejected++;
+            continue;
+        }
+
+        int planesCrossed = (outcode0 | outcode1 | outcode2) & CLIP_PLANE_BITS;
+
+        // The common case, nothing to clip
+        if (planesCrossed == 0)
+        {
+            output.emplace_back();
+            ProjectTriangle(vertices[0], vertices[1], vertices[2], halfWidth, halfHeight, output.back());
+            stats.NumOutput++;
+            continue;
+        }
+
+        ClipVertex polygon[MAX_POLYGON_VERTICES];
+        ClipVertex clipped[MAX_POLYGON_VERTICES];
+        int        numVertices = 3;
+
+        polygon[0] = vertices[0];
+        polygon[1] = vertices[1];
+        polygon[2] = vertices[2];
+
+        // Only the planes some vertex is outside of can cut the triangle
+        for (int plane = 0; plane < NUM_CLIP_PLANES && numVertices > 0; plane++)
+        {
+            if ((planesCrossed & (1 << plane)) != 0)
+            {
+                numVertices = ClipPolygon(polygon, numVertices, clipped, plane, guardBand);
+                std::copy(clipped, clipped + numVertices, polygon);
+            }
+        }
+
+        stats.NumClipped++;
+
+        // Split the convex polygon into a fan of triangles, which keeps the winding of the original triangle
+        for (int i = 1; i + 1 < numVertices; i++)
+        {
+            output.emplace_back();
+            ProjectTriangle(polygon[0], polygon[i], polygon[i + 1], halfWidth, halfHeight, output.back());
+            stats.NumOutput++;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <vector>
+
+#include "Utilities/span.h"
+
+struct Triangle;
+
+// How far past each side of the screen triangles are left for the rasterizer to clip to the screen by itself, in
+// pixels. Only triangles that reach beyond this band get clipped geometrically. It is kept small enough that the
+// screen coordinates of anything inside it stay well within the range the integer backends can step exactly.
+const int GUARD_BAND_PIXELS = 4096;
+
+// A vertex after the projection matrix, before the division by w
+struct ClipVertex
+{
+    glm::vec4 Position;
+    glm::vec2 TexCoord;
+    glm::vec3 Normal;
+};
+
+struct ClipTriangle
+{
+    ClipVertex Vertices[3];
+};
+
+// What the clip stage did with the triangles it was given
+struct ClipStats
+{
+    int NumTriangles = 0;
+    // Entirely outside the screen, or entirely in front of the near plane or behind the far plane
+    int NumRejected = 0;
+    // Crossing the near or far plane or the guard band, and cut into smaller triangles
+    int NumClipped = 0;
+    // Triangles handed on to the rasterizer, counting every piece of the clipped ones
+    int NumOutput = 0;
+};
+
+// Clips the triangles in homogeneous clip space and turns what is left into screen space triangles for a screen of
+// width x height pixels, appending them to output in order. Larger depths are nearer to the camera, like in the
+// zBuffer, so the visible volume is -w <= x, y, z <= w with the near plane at z = w.
+//
+// Triangles entirely outside one of the planes of that volume are rejected outright by comparing the outcodes of their
+// vertices. Triangles that only stick out of the sides of the screen are left alone as long as they stay inside the
+// guard band, the rasterizer never visits pixels outside the screen anyway. Only the few triangles crossing the near
+// or far plane or the guard band are clipped with Sutherland-Hodgman, and the resulting polygon split into a fan.
+void ClipTriangles(Span<const ClipTriangle> triangles, int width, int height, std::vector<Triangle>& output,
+                   ClipStats& stats);
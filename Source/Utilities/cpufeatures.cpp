@@ -0,0 +1,87 @@
+#include "cpufeatures.h"
+
+#if RENDERER_X86 && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+static CpuFeatures DetectCpuFeatures()
+{
+    CpuFeatures features = {};
+
+#if RENDERER_X86 && defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    features.SSE2 = (info[3] & (1 << 26)) != 0;
+
+    // The AVX registers are only usable if the OS saves them on context switches, which it advertises through XCR0
+    bool osxsave  = (info[2] & (1 << 27)) != 0;
+    bool avxOS    = false;
+    bool avx512OS = false;
+    if (osxsave)
+    {
+        unsigned long long xcr0 = _xgetbv(0);
+        avxOS                   = (xcr0 & 0x6) == 0x6;
+        avx512OS                = (xcr0 & 0xe6) == 0xe6;
+    }
+
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        features.AVX2    = avxOS && (info[1] & (1 << 5)) != 0;
+        features.AVX512F = avx512OS && (info[1] & (1 << 16)) != 0;
+    }
+#elif RENDERER_X86
+    // These also check that the OS has enabled the wider registers
+    __builtin_cpu_init();
+    features.SSE2    = __builtin_cpu_supports("sse2");
+    features.AVX2    = __builtin_cpu_supports("avx2");
+    features.AVX512F = __builtin_cpu_supports("avx512f");
+#endif
+
+    return features;
+}
+
+const CpuFeatures& GetCpuFeatures()
+{
+    static const CpuFeatures features = DetectCpuFeatures();
+    return features;
+}
+
+SimdLevel GetBestSimdLevel()
+{
+    const CpuFeatures& features = GetCpuFeatures();
+
+    if (features.AVX512F)
+    {
+        return SimdLevel::AVX512;
+    }
+    if (features.AVX2)
+    {
+        return SimdLevel::AVX2;
+    }
+    if (features.SSE2)
+    {
+        return SimdLevel::SSE2;
+    }
+    return SimdLevel::None;
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::SSE2:
+        return "SSE2";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    default:
+        return "None";
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RENDERER_X86 1
+#else
+#define RENDERER_X86 0
+#endif
+
+// The vector instruction sets the SIMD kernels are written for, from narrowest to widest
+enum class SimdLevel
+{
+    None,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+struct CpuFeatures
+{
+    bool SSE2;
+    bool AVX2;
+    bool AVX512F;
+};
+
+// Queries the CPU once and caches the result
+const CpuFeatures& GetCpuFeatures();
+
+// The widest SIMD level that both the CPU and the operating system support
+SimdLevel GetBestSimdLevel();
+
+const char* GetSimdLevelName(SimdLevel level);
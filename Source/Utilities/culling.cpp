@@ -0,0 +1,76 @@
+#include "culling.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "Utilities/rasterizer.h"
+#include "Utilities/trianglesetup.h"
+
+void CullTriangles(const std::vector<Triangle>& triangles, int first, int count, CullMode mode,
+                   std::vector<int>& visibleIndices, CullStats& stats)
+{
+    // The vertices of the batch, one array per coordinate
+    alignas(64) std::int32_t x0[CULL_BATCH_SIZE], y0[CULL_BATCH_SIZE];
+    alignas(64) std::int32_t x1[CULL_BATCH_SIZE], y1[CULL_BATCH_SIZE];
+    alignas(64) std::int32_t x2[CULL_BATCH_SIZE], y2[CULL_BATCH_SIZE];
+    alignas(64) std::int64_t areas[CULL_BATCH_SIZE];
+
+    stats.NumTriangles += count;
+
+    for (int batchStart = first; batchStart < first + count; batchStart += CULL_BATCH_SIZE)
+    {
+        int batchSize = std::min(CULL_BATCH_SIZE, first + count - batchStart);
+
+        for (int i = 0; i < batchSize; i++)
+        {
+            const glm::vec3* vertices = triangles[batchStart + i].ScreenCoords;
+
+            x0[i] = SnapToSubpixel(vertices[0].x);
+            y0[i] = SnapToSubpixel(vertices[0].y);
+            x1[i] = SnapToSubpixel(vertices[1].x);
+            y1[i] = SnapToSubpixel(vertices[1].y);
+            x2[i] = SnapToSubpixel(vertices[2].x);
+            y2[i] = SnapToSubpixel(vertices[2].y);
+        }
+
+        // Same value as GetSignedArea, which SetupTriangle goes by. Negative for counter clockwise triangles, positive
+        // for clockwise ones.
+        for (int i = 0; i < batchSize; i++)
+        {
+            areas[i] = static_cast<std::int64_t>(y2[i] - y1[i]) * (x0[i] - x1[i]) +
+                       static_cast<std::int64_t>(x1[i] - x2[i]) * (y0[i] - y1[i]);
+        }
+
+        // Pixels are sampled at integer coordinates, so a triangle whose bounds fall between two of them in either
+        // direction can't cover any pixel, no matter its area
+        for (int i = 0; i < batchSize; i++)
+        {
+            std::int32_t minX = std::min(x0[i], std::min(x1[i], x2[i]));
+            std::int32_t minY = std::min(y0[i], std::min(y1[i], y2[i]));
+            std::int32_t maxX = std::max(x0[i], std::max(x1[i], x2[i]));
+            std::int32_t maxY = std::max(y0[i], std::max(y1[i], y2[i]));
+
+            bool missesPixels = ((minX + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS) > (maxX >> SUBPIXEL_BITS) ||
+                                ((minY + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS) > (maxY >> SUBPIXEL_BITS);
+
+            areas[i] = missesPixels ? 0 : areas[i];
+        }
+
+        for (int i = 0; i < batchSize; i++)
+        {
+            if (areas[i] == 0)
+            {
+                stats.NumDegenerate++;
+            }
+            else if ((mode == CullMode::Clockwise && areas[i] > 0) ||
+                     (mode == CullMode::CounterClockwise && areas[i] < 0))
+            {
+                stats.NumBackFacing++;
+            }
+            else
+            {
+                visibleIndices.push_back(batchStart + i);
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+struct Triangle;
+
+// Which triangles the culling stage throws away, based on the winding of their screen space vertices with y pointing
+// up. The models are wound counter clockwise, so their back faces are the clockwise triangles.
+enum class CullMode
+{
+    None,
+    Clockwise,
+    CounterClockwise
+};
+
+// How many triangles the culling stage has looked at, and why it dropped the ones it did
+struct CullStats
+{
+    int NumTriangles  = 0;
+    int NumBackFacing = 0;
+    // Triangles with no area once their vertices are snapped to the sub-pixel grid, or too small to reach a pixel
+    int NumDegenerate = 0;
+
+    inline int GetNumCulled() const { return NumBackFacing + NumDegenerate; }
+
+    inline CullStats& operator+=(const CullStats& other)
+    {
+        NumTriangles += other.NumTriangles;
+        NumBackFacing += other.NumBackFacing;
+        NumDegenerate += other.NumDegenerate;
+        return *this;
+    }
+};
+
+// The number of triangles classified together. Their vertices are first gathered into one array per coordinate, so
+// that the areas can then be computed in a plain loop over those arrays, which the compiler turns into SIMD code.
+const int CULL_BATCH_SIZE = 64;
+
+// Computes the signed area of the triangles [first, first + count) the same way the rasterizer does, and appends the
+// indices of those that can end up on screen to visibleIndices, in order. Adds the counts to stats.
+void CullTriangles(const std::vector<Triangle>& triangles, int first, int count, CullMode mode,
+                   std::vector<int>& visibleIndices, CullStats& stats);
@@ -0,0 +1,70 @@
+#include "hizbuffer.h"
+
+#include <algorithm>
+
+HiZBuffer::HiZBuffer(int width, int height)
+    : m_Width(width), m_Height(height), m_NumTilesX((width + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE),
+      m_NumTilesY((height + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE), m_MinDepth(m_NumTilesX * m_NumTilesY),
+      m_MaxDepth(m_NumTilesX * m_NumTilesY)
+{
+}
+
+void HiZBuffer::Clear(float depth)
+{
+    std::fill(m_MinDepth.begin(), m_MinDepth.end(), depth);
+    std::fill(m_MaxDepth.begin(), m_MaxDepth.end(), depth);
+}
+
+void HiZBuffer::UpdateTile(int tileX, int tileY, const float* zBuffer)
+{
+    int minX = tileX * HIZ_TILE_SIZE;
+    int minY = tileY * HIZ_TILE_SIZE;
+
+    // Tiles along the right and bottom edges can be cut short by the screen
+    int maxX = std::min(minX + HIZ_TILE_SIZE, m_Width);
+    int maxY = std::min(minY + HIZ_TILE_SIZE, m_Height);
+
+    float minDepth = zBuffer[minX + minY * m_Width];
+    float maxDepth = minDepth;
+
+    for (int y = minY; y < maxY; y++)
+    {
+        const float* row = zBuffer + y * m_Width;
+        for (int x = minX; x < maxX; x++)
+        {
+            minDepth = std::min(minDepth, row[x]);
+            maxDepth = std::max(maxDepth, row[x]);
+        }
+    }
+
+    m_MinDepth[tileX + tileY * m_NumTilesX] = minDepth;
+    m_MaxDepth[tileX + tileY * m_NumTilesX] = maxDepth;
+}
+
+void HiZBuffer::UpdateRect(int minX, int minY, int maxX, int maxY, const float* zBuffer)
+{
+    for (int tileY = minY / HIZ_TILE_SIZE; tileY <= maxY / HIZ_TILE_SIZE; tileY++)
+    {
+        for (int tileX = minX / HIZ_TILE_SIZE; tileX <= maxX / HIZ_TILE_SIZE; tileX++)
+        {
+            UpdateTile(tileX, tileY, zBuffer);
+        }
+    }
+}
+
+bool HiZBuffer::IsOccluded(int minX, int minY, int maxX, int maxY, float nearestDepth) const
+{
+    for (int tileY = minY / HIZ_TILE_SIZE; tileY <= maxY / HIZ_TILE_SIZE; tileY++)
+    {
+        for (int tileX = minX / HIZ_TILE_SIZE; tileX <= maxX / HIZ_TILE_SIZE; tileX++)
+        {
+            // A pixel is only drawn if it is strictly closer than what is already there
+            if (nearestDepth > GetMinDepth(tileX, tileY))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
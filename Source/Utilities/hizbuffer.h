@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+// The size of the square screen tiles the Hi-Z buffer keeps depth bounds for, in pixels
+const int HIZ_TILE_SIZE = 8;
+
+// A coarse version of the zBuffer, keeping the smallest and largest depth of every HIZ_TILE_SIZE tile. Larger depths
+// are closer to the camera, so the smallest depth of a tile is its farthest pixel and the largest is its closest.
+//
+// The bounds are conservative: the min is never larger and the max never smaller than the actual depths in the tile.
+// That lets a whole triangle or tile be rejected without reading the zBuffer when it is entirely behind the farthest
+// pixel already drawn there.
+class HiZBuffer
+{
+
+  public:
+    HiZBuffer(int width, int height);
+
+    // Resets every tile, to be called along with clearing the zBuffer to the same depth
+    void Clear(float depth);
+
+    // Recomputes the bounds of a tile from the zBuffer. zBuffer has the same width and height as the Hi-Z buffer.
+    void UpdateTile(int tileX, int tileY, const float* zBuffer);
+
+    // Recomputes the bounds of every tile overlapping the pixels [minX, maxX] x [minY, maxY]
+    void UpdateRect(int minX, int minY, int maxX, int maxY, const float* zBuffer);
+
+    // Whether something with the given nearest depth would fail the depth test at every pixel of the tiles overlapping
+    // [minX, maxX] x [minY, maxY]
+    bool IsOccluded(int minX, int minY, int maxX, int maxY, float nearestDepth) const;
+
+    inline float GetMinDepth(int tileX, int tileY) const { return m_MinDepth[tileX + tileY * m_NumTilesX]; }
+    inline float GetMaxDepth(int tileX, int tileY) const { return m_MaxDepth[tileX + tileY * m_NumTilesX]; }
+
+    inline int GetNumTilesX() const { return m_NumTilesX; }
+    inline int GetNumTilesY() const { return m_NumTilesY; }
+
+  private:
+    int m_Width;
+    int m_Height;
+    int m_NumTilesX;
+    int m_NumTilesY;
+
+    std::vector<float> m_MinDepth;
+    std::vector<float> m_MaxDepth;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Utilities/span.h"
+
+// A list of vertex indices that takes 16 bits per index when every index fits, and 32 bits otherwise. Most meshes
+// have fewer than 65536 vertices, and halving the size of their index buffer halves the memory traffic of reading it.
+//
+// The indices are either stored in the buffer itself or referenced from memory someone else owns, like a mapped mesh
+// cache. Either way they are read through the same views.
+class IndexBuffer
+{
+
+  public:
+    IndexBuffer() = default;
+
+    // The views would point into the vectors of the original
+    IndexBuffer(const IndexBuffer&)            = delete;
+    IndexBuffer& operator=(const IndexBuffer&) = delete;
+
+    // Replaces the contents with a copy of the given indices, all of which have to be smaller than numVertices
+    inline void Assign(const std::vector<std::uint32_t>& indices, std::uint32_t numVertices)
+    {
+        m_Is16Bit = numVertices <= 65536;
+
+        if (m_Is16Bit)
+        {
+            m_Indices16.assign(indices.begin(), indices.end());
+            m_Indices32.clear();
+        }
+        else
+        {
+            m_Indices32 = indices;
+            m_Indices16.clear();
+        }
+
+        m_View16 = m_Indices16;
+        m_View32 = m_Indices32;
+    }
+
+    // Same, but takes over the vector itself when the indices are kept at 32 bits
+    inline void Assign(std::vector<std::uint32_t>&& indices, std::uint32_t numVertices)
+    {
+        if (numVertices <= 65536)
+        {
+            Assign(indices, numVertices);
+            return;
+        }
+
+        m_Is16Bit   = false;
+        m_Indices32 = std::move(indices);
+        m_Indices16.clear();
+
+        m_View16 = m_Indices16;
+        m_View32 = m_Indices32;
+    }
+
+    // Makes the buffer refer to indices stored elsewhere, which have to outlive it or the next Assign
+    inline void Reference(Span<const std::uint16_t> indices)
+    {
+        m_Indices16.clear();
+        m_Indices32.clear();
+
+        m_Is16Bit = true;
+        m_View16  = indices;
+        m_View32  = Span<const std::uint32_t>();
+    }
+
+    inline void Reference(Span<const std::uint32_t> indices)
+    {
+        m_Indices16.clear();
+        m_Indices32.clear();
+
+        m_Is16Bit = false;
+        m_View16  = Span<const std::uint16_t>();
+        m_View32  = indices;
+    }
+
+    inline std::uint32_t operator[](size_t index) const { return m_Is16Bit ? m_View16[index] : m_View32[index]; }
+
+    inline size_t GetSize() const { return m_Is16Bit ? m_View16.size() : m_View32.size(); }
+    inline size_t GetSizeInBytes() const { return GetSize() * (m_Is16Bit ? 2 : 4); }
+    inline bool   Is16Bit() const { return m_Is16Bit; }
+
+    // Only the one matching Is16Bit holds anything
+    inline Span<const std::uint16_t> GetIndices16() const { return m_View16; }
+    inline Span<const std::uint32_t> GetIndices32() const { return m_View32; }
+
+  private:
+    std::vector<std::uint16_t> m_Indices16;
+    std::vector<std::uint32_t> m_Indices32;
+    Span<const std::uint16_t>  m_View16;
+    Span<const std::uint32_t>  m_View32;
+    bool                       m_Is16Bit = false;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A file mapped read-only into memory. The operating system pages its contents in on first access, straight from the
+// file cache, so opening even a large file costs next to nothing and nothing gets copied into buffers of our own.
+class MappedFile
+{
+
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps the whole file, closing whatever was mapped before. Returns false if the file does not exist, is empty or
+    // can't be mapped.
+    bool Open(const std::string& path);
+    void Close();
+
+    inline bool                IsOpen() const { return m_Data != nullptr; }
+    inline const std::uint8_t* GetData() const { return m_Data; }
+    inline std::size_t         GetSize() const { return m_Size; }
+
+  private:
+    const std::uint8_t* m_Data = nullptr;
+    std::size_t         m_Size = 0;
+
+#ifdef _WIN32
+    // The handles of the file and of its mapping, kept as void* to keep windows.h out of this header
+    void* m_File    = nullptr;
+    void* m_Mapping = nullptr;
+#endif
+};
@@ -0,0 +1,384 @@
+#include "meshcache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+// Every array starts on a cache line, which also covers the alignment of any SIMD load
+const std::uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+// "MESH" when read as four characters
+const std::uint32_t MESH_CACHE_MAGIC = 0x4853454d;
+
+// Where an array is in the file, in bytes from the start, and how many elements it has
+struct MeshCacheArray
+{
+    std::uint64_t Offset;
+    std::uint64_t Count;
+};
+
+struct MeshCacheHeader
+{
+    std::uint32_t Magic;
+    std::uint32_t Version;
+    std::uint64_t SourceSize;
+    std::int64_t  SourceModificationTime;
+
+    // 2 or 4 bytes per index
+    std::uint32_t IndexSize;
+
+    // Non-zero if the mesh was optimized, with the options and the stats below
+    std::uint32_t         IsOptimized;
+    std::uint32_t         SortFrontToBack;
+    glm::vec3             ViewDirection;
+    MeshOptimizationStats OptimizationStats;
+
+    MeshCacheArray Vertices;
+    MeshCacheArray Normals;
+    MeshCacheArray TexCoords;
+    MeshCacheArray Faces;
+    MeshCacheArray WeldedVertices;
+    MeshCacheArray Indices;
+    MeshCacheArray DrawBatches;
+    // The name and diffuse texture name of every material, each followed by a line break
+    MeshCacheArray MaterialNames;
+    // The name of every material library, each followed by a line break, and the MeshCacheFileStamp of each
+    MeshCacheArray MaterialLibraryNames;
+    MeshCacheArray MaterialLibraryStamps;
+};
+
+// The arrays are written and read as raw bytes, which only works for types without padding or pointers
+static_assert(std::is_trivially_copyable<Face>::value && sizeof(Face) == 9 * sizeof(int), "Face is stored as is");
+static_assert(std::is_trivially_copyable<DrawBatch>::value && sizeof(DrawBatch) == 3 * sizeof(int),
+              "DrawBatch is stored as is");
+static_assert(std::is_trivially_copyable<Vertex>::value && sizeof(Vertex) == 8 * sizeof(float),
+              "Vertex is stored as is");
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::vec2) == 2 * sizeof(float),
+              "Vectors are stored as is");
+static_assert(std::is_trivially_copyable<MeshOptimizationStats>::value &&
+                  sizeof(MeshOptimizationStats) == 4 * sizeof(float),
+              "MeshOptimizationStats is stored as is");
+static_assert(std::is_trivially_copyable<MeshCacheFileStamp>::value && sizeof(MeshCacheFileStamp) == 16,
+              "MeshCacheFileStamp is stored as is");
+
+static std::uint64_t AlignOffset(std::uint64_t offset)
+{
+    return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+}
+
+// Returns false, with a stamp of all zeros, if the file can't be found
+static bool GetFileStamp(const std::filesystem::path& path, MeshCacheFileStamp& stamp)
+{
+    std::error_code error;
+    stamp = {};
+
+    std::uint64_t size = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    std::int64_t modificationTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    if (error)
+    {
+        return false;
+    }
+
+    stamp = {size, modificationTime};
+    return true;
+}
+
+static bool operator==(const MeshCacheFileStamp& a, const MeshCacheFileStamp& b)
+{
+    return a.Size == b.Size && a.ModificationTime == b.ModificationTime;
+}
+
+bool GetMeshCacheSource(const std::string& path, const std::vector<std::string>& materialLibraries,
+                        MeshCacheSource& source)
+{
+    MeshCacheFileStamp stamp;
+    if (!GetFileStamp(path, stamp))
+    {
+        return false;
+    }
+
+    source.Size             = stamp.Size;
+    source.ModificationTime = stamp.ModificationTime;
+
+    // The parsers look for the libraries next to the OBJ file
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+    source.MaterialLibraries = materialLibraries;
+    source.MaterialLibraryStamps.resize(materialLibraries.size());
+    for (size_t i = 0; i < materialLibraries.size(); i++)
+    {
+        GetFileStamp(directory / materialLibraries[i], source.MaterialLibraryStamps[i]);
+    }
+
+    return true;
+}
+
+bool WriteMeshCache(const std::string& path, const MeshCacheSource& source, const MeshCacheContents& contents)
+{
+    bool is16Bit = !contents.Indices16.empty();
+
+    std::string materialNames;
+    for (const Material& material : contents.Materials)
+    {
+        materialNames += material.Name + '\n' + material.DiffuseTextureName + '\n';
+    }
+
+    std::string libraryNames;
+    for (const std::string& library : source.MaterialLibraries)
+    {
+        libraryNames += library + '\n';
+    }
+
+    MeshCacheHeader header        = {};
+    header.Magic                  = MESH_CACHE_MAGIC;
+    header.Version                = MESH_CACHE_VERSION;
+    header.SourceSize             = source.Size;
+    header.SourceModificationTime = source.ModificationTime;
+    header.IndexSize              = is16Bit ? 2 : 4;
+    header.IsOptimized            = contents.IsOptimized;
+    header.SortFrontToBack        = contents.OptimizationOptions.SortFrontToBack;
+    header.ViewDirection          = contents.OptimizationOptions.ViewDirection;
+    header.OptimizationStats      = contents.OptimizationStats;
+
+    // The arrays in the order they are written, with where each one ends up
+    struct Array
+    {
+        const void*     Data;
+        std::uint64_t   Count;
+        std::uint64_t   ElementSize;
+        MeshCacheArray& Location;
+    };
+
+    Array arrays[] = {
+        {contents.Vertices.data(), contents.Vertices.size(), sizeof(glm::vec3), header.Vertices},
+        {contents.Normals.data(), contents.Normals.size(), sizeof(glm::vec3), header.Normals},
+        {contents.TexCoords.data(), contents.TexCoords.size(), sizeof(glm::vec2), header.TexCoords},
+        {contents.Faces.data(), contents.Faces.size(), sizeof(Face), header.Faces},
+        {contents.WeldedVertices.data(), contents.WeldedVertices.size(), sizeof(Vertex), header.WeldedVertices},
+        {is16Bit ? static_cast<const void*>(contents.Indices16.data()) : contents.Indices32.data(),
+         is16Bit ? contents.Indices16.size() : contents.Indices32.size(), header.IndexSize, header.Indices},
+        {contents.DrawBatches.data(), contents.DrawBatches.size(), sizeof(DrawBatch), header.DrawBatches},
+        {materialNames.data(), materialNames.size(), 1, header.MaterialNames},
+        {libraryNames.data(), libraryNames.size(), 1, header.MaterialLibraryNames},
+        {source.MaterialLibraryStamps.data(), source.MaterialLibraryStamps.size(), sizeof(MeshCacheFileStamp),
+         header.MaterialLibraryStamps},
+    };
+
+    std::uint64_t offset = AlignOffset(sizeof(MeshCacheHeader));
+    for (Array& array : arrays)
+    {
+        array.Location.Offset = offset;
+        array.Location.Count  = array.Count;
+        offset                = AlignOffset(offset + array.Count * array.ElementSize);
+    }
+
+    // Models can load on several threads at once, possibly the same one twice, so every thread writes its own file.
+    // Renaming is atomic, whichever of them gets there last wins with an identical copy.
+    std::size_t   threadId      = std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::string   temporaryPath = path + "." + std::to_string(threadId) + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    const char padding[MESH_CACHE_ALIGNMENT] = {};
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::uint64_t position = sizeof(header);
+
+    for (const Array& array : arrays)
+    {
+        file.write(padding, array.Location.Offset - position);
+        file.write(static_cast<const char*>(array.Data), array.Count * array.ElementSize);
+        position = array.Location.Offset + array.Count * array.ElementSize;
+    }
+
+    file.close();
+    if (!file)
+    {
+        std::filesystem::remove(temporaryPath);
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
+
+// Points the span at an array of the file, after checking that the array lies entirely inside of it
+template <typename T>
+static bool GetArray(const MappedFile& file, const MeshCacheArray& array, Span<const T>& span)
+{
+    if (array.Offset % alignof(T) != 0 || array.Offset > file.GetSize() ||
+        array.Count > (file.GetSize() - array.Offset) / sizeof(T))
+    {
+        return false;
+    }
+
+    span = Span<const T>(reinterpret_cast<const T*>(file.GetData() + array.Offset), array.Count);
+    return true;
+}
+
+// The lines of text, each of which ends with a line break
+static std::vector<std::string> GetLines(Span<const char> text)
+{
+    std::vector<std::string> lines;
+    const char*              line = text.begin();
+
+    for (const char* c = text.begin(); c != text.end(); c++)
+    {
+        if (*c == '\n')
+        {
+            lines.emplace_back(line, c);
+            line = c + 1;
+        }
+    }
+    return lines;
+}
+
+// Whether every index is below count
+template <typename T>
+static bool AreIndicesInRange(Span<const T> indices, size_t count)
+{
+    for (T index : indices)
+    {
+        if (index >= count)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether index is below count, or -1 where the attribute may be left out
+static bool IsIndexInRange(int index, size_t count, bool isOptional)
+{
+    return (isOptional && index == -1) || (index >= 0 && static_cast<size_t>(index) < count);
+}
+
+bool ReadMeshCache(const MappedFile& file, const std::string& sourcePath, MeshCacheContents& contents)
+{
+    if (file.GetSize() < sizeof(MeshCacheHeader))
+    {
+        return false;
+    }
+
+    MeshCacheHeader header;
+    std::memcpy(&header, file.GetData(), sizeof(header));
+
+    if (header.Magic != MESH_CACHE_MAGIC || header.Version != MESH_CACHE_VERSION)
+    {
+        return false;
+    }
+
+    // Only the cache knows which material libraries the OBJ file names, without parsing it again
+    Span<const char>               libraryNames;
+    Span<const MeshCacheFileStamp> libraryStamps;
+    MeshCacheSource                source;
+
+    if (!GetArray(file, header.MaterialLibraryNames, libraryNames) ||
+        !GetArray(file, header.MaterialLibraryStamps, libraryStamps) ||
+        !GetMeshCacheSource(sourcePath, GetLines(libraryNames), source) ||
+        source.MaterialLibraryStamps.size() != libraryStamps.size())
+    {
+        return false;
+    }
+
+    if (header.SourceSize != source.Size || header.SourceModificationTime != source.ModificationTime ||
+        !std::equal(libraryStamps.begin(), libraryStamps.end(), source.MaterialLibraryStamps.begin()))
+    {
+        return false;
+    }
+
+    Span<const char> materialNames;
+
+    bool isValid = GetArray(file, header.Vertices, contents.Vertices) &&
+                   GetArray(file, header.Normals, contents.Normals) &&
+                   GetArray(file, header.TexCoords, contents.TexCoords) &&
+                   GetArray(file, header.Faces, contents.Faces) &&
+                   GetArray(file, header.WeldedVertices, contents.WeldedVertices) &&
+                   GetArray(file, header.DrawBatches, contents.DrawBatches) &&
+                   GetArray(file, header.MaterialNames, materialNames);
+
+    if (header.IndexSize == 2)
+    {
+        isValid            = isValid && GetArray(file, header.Indices, contents.Indices16);
+        contents.Indices32 = Span<const std::uint32_t>();
+    }
+    else if (header.IndexSize == 4)
+    {
+        isValid            = isValid && GetArray(file, header.Indices, contents.Indices32);
+        contents.Indices16 = Span<const std::uint16_t>();
+    }
+    else
+    {
+        isValid = false;
+    }
+
+    if (!isValid)
+    {
+        return false;
+    }
+
+    contents.IsOptimized                         = header.IsOptimized != 0;
+    contents.OptimizationOptions.SortFrontToBack = header.SortFrontToBack != 0;
+    contents.OptimizationOptions.ViewDirection   = header.ViewDirection;
+    contents.OptimizationStats                   = header.OptimizationStats;
+
+    // Two lines per material
+    std::vector<std::string> lines = GetLines(materialNames);
+
+    contents.Materials.clear();
+    for (size_t i = 0; i + 1 < lines.size(); i += 2)
+    {
+        contents.Materials.push_back({lines[i], lines[i + 1]});
+    }
+
+    // Every batch has to refer to a material and to faces that exist
+    for (const DrawBatch& batch : contents.DrawBatches)
+    {
+        if (batch.MaterialIndex < 0 || batch.MaterialIndex >= static_cast<int>(contents.Materials.size()) ||
+            batch.FirstFace < 0 || batch.NumFaces < 0 ||
+            static_cast<size_t>(batch.FirstFace) + batch.NumFaces > contents.Faces.size())
+        {
+            return false;
+        }
+    }
+
+    // The model indexes the arrays without any checks, so a cache that was damaged or written by buggy code must not
+    // get that far. Three indices per face, each one a welded vertex.
+    size_t numIndices = header.IndexSize == 2 ? contents.Indices16.size() : contents.Indices32.size();
+    if (numIndices != contents.Faces.size() * 3 ||
+        !AreIndicesInRange(contents.Indices16, contents.WeldedVertices.size()) ||
+        !AreIndicesInRange(contents.Indices32, contents.WeldedVertices.size()))
+    {
+        return false;
+    }
+
+    // Every corner of every face has a position, and may leave out its normal and texture coordinate
+    for (const Face& face : contents.Faces)
+    {
+        for (const Index& corner : face)
+        {
+            if (!IsIndexInRange(corner.VertexIndex, contents.Vertices.size(), false) ||
+                !IsIndexInRange(corner.NormalIndex, contents.Normals.size(), true) ||
+                !IsIndexInRange(corner.TexCoordIndex, contents.TexCoords.size(), true))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
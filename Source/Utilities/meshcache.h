@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Utilities/mappedfile.h"
+#include "Utilities/model.h"
+#include "Utilities/span.h"
+
+// A binary copy of everything a Model is made of, written next to the OBJ file the first time it is loaded. Later
+// loads map the cache into memory and use its arrays where they are, with no parsing and no copying at all.
+//
+// The file starts with a MeshCacheHeader, followed by the arrays it points to, each starting on a 64 byte boundary.
+// The arrays are stored exactly as they are laid out in memory, in the byte order of the machine that wrote them, so
+// a cache is only meant for the machine it was built on. The cache records the size and modification time of the
+// OBJ file and of every material library it names, and a cache that doesn't match them, or was written by a different
+// version of the code, is ignored.
+
+// Appended to the name of the OBJ file to get the name of its cache
+const char* const MESH_CACHE_EXTENSION = ".meshcache";
+
+// To be incremented whenever the layout of the file or of any of the types stored in it changes
+const std::uint32_t MESH_CACHE_VERSION = 4;
+
+// Identifies the version of a file, all zeros for a file that doesn't exist
+struct MeshCacheFileStamp
+{
+    std::uint64_t Size             = 0;
+    std::int64_t  ModificationTime = 0;
+};
+
+// Identifies the version of the OBJ file a cache was built from, and of the material libraries it was built with
+struct MeshCacheSource
+{
+    std::uint64_t Size             = 0;
+    std::int64_t  ModificationTime = 0;
+    // The libraries as named by the mtllib records, relative to the directory of the OBJ file, and their versions
+    std::vector<std::string>        MaterialLibraries;
+    std::vector<MeshCacheFileStamp> MaterialLibraryStamps;
+};
+
+// The arrays of a model, wherever they are stored. Exactly one of the index arrays is used.
+struct MeshCacheContents
+{
+    Span<const glm::vec3>     Vertices;
+    Span<const glm::vec3>     Normals;
+    Span<const glm::vec2>     TexCoords;
+    Span<const Face>          Faces;
+    Span<const Vertex>        WeldedVertices;
+    Span<const std::uint16_t> Indices16;
+    Span<const std::uint32_t> Indices32;
+    Span<const DrawBatch>     DrawBatches;
+    // Copied rather than viewed, since they hold strings
+    std::vector<Material> Materials;
+
+    // Whether the faces and indices are in the order Model::OptimizeMesh put them in, with which options and to what
+    // effect. An optimized cache saves redoing the optimization on every load.
+    bool                    IsOptimized = false;
+    MeshOptimizationOptions OptimizationOptions;
+    MeshOptimizationStats   OptimizationStats;
+};
+
+// Gets the versions of the OBJ file at path and of the given material libraries of it. Returns false if the OBJ file
+// can't be found, while libraries that can't be found just get a stamp of all zeros.
+bool GetMeshCacheSource(const std::string& path, const std::vector<std::string>& materialLibraries,
+                        MeshCacheSource& source);
+
+// Writes the contents to a new cache file. The file is written under a temporary name first and only renamed once it
+// is complete, so that a crash halfway through never leaves a broken cache behind.
+bool WriteMeshCache(const std::string& path, const MeshCacheSource& source, const MeshCacheContents& contents);
+
+// Checks that the mapped file is a valid cache of the current version of the OBJ file at sourcePath and of the material
+// libraries it was built with, with every index in range, and points the arrays of contents into it. The arrays stay
+// valid for as long as the file stays mapped.
+bool ReadMeshCache(const MappedFile& file, const std::string& sourcePath, MeshCacheContents& contents);
@@ -0,0 +1,390 @@
+#include "meshoptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Utilities/model.h"
+
+// A simulated FIFO post-transform cache. A vertex is still in a cache of n entries if fewer than n vertices have been
+// put in after it, so it is enough to remember when each vertex was last put in.
+class FifoCache
+{
+
+  public:
+    FifoCache(int numVertices, int size) : m_InsertionTime(numVertices, -size - 1), m_Time(0), m_Size(size) {}
+
+    // Looks the vertex up, putting it in the cache if it is not there yet. Returns whether it had to be transformed.
+    inline bool Access(std::uint32_t vertex)
+    {
+        if (m_Time - m_InsertionTime[vertex] <= m_Size)
+        {
+            return false;
+        }
+
+        m_InsertionTime[vertex] = m_Time;
+        m_Time++;
+        return true;
+    }
+
+    // Pushes everything out of the cache
+    inline void Flush() { m_Time += m_Size; }
+
+  private:
+    std::vector<int> m_InsertionTime;
+    int              m_Time;
+    int              m_Size;
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, int numVertices, int cacheSize)
+{
+    FifoCache         cache(numVertices, cacheSize);
+    std::vector<bool> isUsed(numVertices, false);
+
+    int numTransformed = 0;
+    int numUsed        = 0;
+
+    for (std::uint32_t index : indices)
+    {
+        if (cache.Access(index))
+        {
+            numTransformed++;
+        }
+
+        if (!isUsed[index])
+        {
+            isUsed[index] = true;
+            numUsed++;
+        }
+    }
+
+    VertexCacheStats stats;
+    int              numTriangles = static_cast<int>(indices.size() / 3);
+
+    stats.ACMR = numTriangles > 0 ? static_cast<float>(numTransformed) / numTriangles : 0.0f;
+    stats.ATVR = numUsed > 0 ? static_cast<float>(numTransformed) / numUsed : 0.0f;
+
+    return stats;
+}
+
+// The parameters of the scoring function from the paper
+const int   FORSYTH_CACHE_SIZE        = 32;
+const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRIANGLE     = 0.75f;
+const float FORSYTH_VALENCE_BOOST     = 2.0f;
+const float FORSYTH_VALENCE_BOOST_EXP = 0.5f;
+
+static float GetVertexScore(int cachePosition, int numRemainingTriangles)
+{
+    // Nothing left to draw with this vertex, it doesn't matter anymore
+    if (numRemainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // The vertices of the triangle that was just added get a fixed score, so that the next triangle does not
+            // favour one of its edges over the others
+            score = FORSYTH_LAST_TRIANGLE;
+        }
+        else
+        {
+            float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score       = std::pow(1.0f - (cachePosition - 3) * scale, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    // Vertices with few triangles left get a boost, to get rid of them before they fall out of the cache
+    score += FORSYTH_VALENCE_BOOST * std::pow(static_cast<float>(numRemainingTriangles), -FORSYTH_VALENCE_BOOST_EXP);
+
+    return score;
+}
+
+std::vector<int> OptimizeVertexCache(const std::vector<std::uint32_t>& indices, int numVertices)
+{
+    int numTriangles = static_cast<int>(indices.size() / 3);
+
+    std::vector<int> output;
+    output.reserve(numTriangles);
+
+    if (numTriangles == 0)
+    {
+        return output;
+    }
+
+    // The triangles using each vertex, as one array with an offset per vertex. The triangles that have been added are
+    // moved past the end of each vertex' list by decrementing its count.
+    std::vector<int> numRemaining(numVertices, 0);
+    for (std::uint32_t index : indices)
+    {
+        numRemaining[index]++;
+    }
+
+    std::vector<int> firstTriangle(numVertices + 1, 0);
+    for (int vertex = 0; vertex < numVertices; vertex++)
+    {
+        firstTriangle[vertex + 1] = firstTriangle[vertex] + numRemaining[vertex];
+    }
+
+    std::vector<int> vertexTriangles(indices.size());
+    std::vector<int> fillCount(numVertices, 0);
+    for (int triangle = 0; triangle < numTriangles; triangle++)
+    {
+        for (int corner = 0; corner < 3; corner++)
+        {
+            std::uint32_t vertex = indices[triangle * 3 + corner];
+            vertexTriangles[firstTriangle[vertex] + fillCount[vertex]++] = triangle;
+        }
+    }
+
+    std::vector<int>   cachePosition(numVertices, -1);
+    std::vector<float> vertexScore(numVertices);
+    for (int vertex = 0; vertex < numVertices; vertex++)
+    {
+        vertexScore[vertex] = GetVertexScore(-1, numRemaining[vertex]);
+    }
+
+    std::vector<float> triangleScore(numTriangles);
+    std::vector<bool>  isAdded(numTriangles, false);
+    for (int triangle = 0; triangle < numTriangles; triangle++)
+    {
+        triangleScore[triangle] = vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]] +
+                                  vertexScore[indices[triangle * 3 + 2]];
+    }
+
+    int bestTriangle = static_cast<int>(std::max_element(triangleScore.begin(), triangleScore.end()) -
+                                        triangleScore.begin());
+
+    // The simulated LRU cache, with room for the three vertices of a triangle being pushed in front of a full cache
+    std::vector<std::uint32_t> cache;
+    std::vector<std::uint32_t> newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    // Where to continue looking for a triangle when none of the vertices in the cache have any left
+    int scanPosition = 0;
+
+    for (int numOutput = 0; numOutput < numTriangles; numOutput++)
+    {
+        if (bestTriangle < 0)
+        {
+            // Start over somewhere else. Every triangle before scanPosition has already been added.
+            while (isAdded[scanPosition])
+            {
+                scanPosition++;
+            }
+            bestTriangle = scanPosition;
+        }
+
+        const std::uint32_t* triangleVertices = &indices[bestTriangle * 3];
+        isAdded[bestTriangle]                 = true;
+        output.push_back(bestTriangle);
+
+        // Take the triangle out of the lists of its vertices
+        for (int corner = 0; corner < 3; corner++)
+        {
+            std::uint32_t vertex = triangleVertices[corner];
+            int*          list   = &vertexTriangles[firstTriangle[vertex]];
+            int           count  = numRemaining[vertex];
+
+            std::swap(*std::find(list, list + count, bestTriangle), list[count - 1]);
+            numRemaining[vertex]--;
+        }
+
+        // The vertices of the triangle move to the front of the cache, in front of everything else that was there
+        newCache.assign(triangleVertices, triangleVertices + 3);
+        for (std::uint32_t vertex : cache)
+        {
+            if (vertex != triangleVertices[0] && vertex != triangleVertices[1] && vertex != triangleVertices[2])
+            {
+                newCache.push_back(vertex);
+            }
+        }
+
+        // Everything that fell out of the cache loses its cache score
+        for (size_t i = FORSYTH_CACHE_SIZE; i < newCache.size(); i++)
+        {
+            cachePosition[newCache[i]] = -1;
+            vertexScore[newCache[i]]   = GetVertexScore(-1, numRemaining[newCache[i]]);
+        }
+        newCache.resize(std::min<size_t>(newCache.size(), FORSYTH_CACHE_SIZE));
+        std::swap(cache, newCache);
+
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            cachePosition[cache[i]] = static_cast<int>(i);
+            vertexScore[cache[i]]   = GetVertexScore(static_cast<int>(i), numRemaining[cache[i]]);
+        }
+
+        // Only the triangles of vertices in the cache have changed score, so the next one is picked among those
+        bestTriangle    = -1;
+        float bestScore = -1.0f;
+        for (std::uint32_t vertex : cache)
+        {
+            const int* list = &vertexTriangles[firstTriangle[vertex]];
+
+            for (int i = 0; i < numRemaining[vertex]; i++)
+            {
+                int triangle = list[i];
+
+                float score = vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]] +
+                              vertexScore[indices[triangle * 3 + 2]];
+
+                if (score > bestScore)
+                {
+                    bestScore    = score;
+                    bestTriangle = triangle;
+                }
+            }
+        }
+    }
+
+    return output;
+}
+
+std::vector<int> OptimizeOverdraw(const std::vector<std::uint32_t>& indices, Span<const Vertex> vertices,
+                                  const glm::vec3& viewDirection, float threshold)
+{
+    int numTriangles = static_cast<int>(indices.size() / 3);
+
+    // The cache effectively starts over at every triangle whose three vertices all miss it, so the index buffer can be
+    // cut there for free
+    std::vector<int> hardBoundaries;
+    FifoCache        cache(static_cast<int>(vertices.size()), VERTEX_CACHE_SIZE);
+
+    for (int triangle = 0; triangle < numTriangles; triangle++)
+    {
+        int numMisses = 0;
+        for (int corner = 0; corner < 3; corner++)
+        {
+            numMisses += cache.Access(indices[triangle * 3 + corner]);
+        }
+
+        if (numMisses == 3 || triangle == 0)
+        {
+            hardBoundaries.push_back(triangle);
+        }
+    }
+    hardBoundaries.push_back(numTriangles);
+
+    // A well optimized mesh has few of those though, so the pieces in between get cut further, wherever the piece so
+    // far is already about as cache friendly as the whole piece is. Starting over with an empty cache there costs
+    // little more than threshold times the misses the piece would have had anyway.
+    std::vector<int> clusterStarts;
+
+    for (size_t i = 0; i + 1 < hardBoundaries.size(); i++)
+    {
+        int first = hardBoundaries[i];
+        int last  = hardBoundaries[i + 1];
+
+        cache.Flush();
+        int numMisses = 0;
+        for (int index = first * 3; index < last * 3; index++)
+        {
+            numMisses += cache.Access(indices[index]);
+        }
+        float maxClusterACMR = threshold * numMisses / (last - first);
+
+        cache.Flush();
+        int clusterStart = first;
+        numMisses        = 0;
+        clusterStarts.push_back(first);
+
+        for (int triangle = first; triangle < last; triangle++)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                numMisses += cache.Access(indices[triangle * 3 + corner]);
+            }
+
+            if (triangle + 1 < last && numMisses <= maxClusterACMR * (triangle + 1 - clusterStart))
+            {
+                clusterStart = triangle + 1;
+                numMisses    = 0;
+                clusterStarts.push_back(clusterStart);
+                cache.Flush();
+            }
+        }
+    }
+    clusterStarts.push_back(numTriangles);
+
+    struct Cluster
+    {
+        int   FirstTriangle;
+        int   LastTriangle;
+        float Depth;
+    };
+
+    std::vector<Cluster> clusters(clusterStarts.size() - 1);
+
+    for (size_t i = 0; i < clusters.size(); i++)
+    {
+        Cluster& cluster      = clusters[i];
+        cluster.FirstTriangle = clusterStarts[i];
+        cluster.LastTriangle  = clusterStarts[i + 1];
+
+        glm::vec3 center(0.0f);
+        for (int index = cluster.FirstTriangle * 3; index < cluster.LastTriangle * 3; index++)
+        {
+            center += vertices[indices[index]].Position;
+        }
+        center = center * (1.0f / ((cluster.LastTriangle - cluster.FirstTriangle) * 3));
+
+        // How far along the view direction the cluster is, smaller is closer to the viewer
+        cluster.Depth = glm::dot(center, viewDirection);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster& a, const Cluster& b) { return a.Depth < b.Depth; });
+
+    std::vector<int> output;
+    output.reserve(numTriangles);
+
+    for (const Cluster& cluster : clusters)
+    {
+        for (int triangle = cluster.FirstTriangle; triangle < cluster.LastTriangle; triangle++)
+        {
+            output.push_back(triangle);
+        }
+    }
+
+    return output;
+}
+
+void ReorderTriangles(std::vector<std::uint32_t>& indices, const std::vector<int>& triangleOrder)
+{
+    std::vector<std::uint32_t> reordered;
+    reordered.reserve(indices.size());
+
+    for (int triangle : triangleOrder)
+    {
+        reordered.insert(reordered.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+    }
+
+    indices.swap(reordered);
+}
+
+void OptimizeVertexFetch(std::vector<std::uint32_t>& indices, std::vector<Vertex>& vertices)
+{
+    const std::uint32_t UNUSED = 0xffffffff;
+
+    std::vector<std::uint32_t> remap(vertices.size(), UNUSED);
+    std::vector<Vertex>        reordered;
+    reordered.reserve(vertices.size());
+
+    for (std::uint32_t& index : indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = static_cast<std::uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(reordered);
+}
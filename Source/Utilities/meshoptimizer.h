@@ -0,0 +1,69 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "Utilities/span.h"
+
+struct Vertex;
+
+// The number of entries of the simulated post-transform cache the metrics are measured with, a FIFO like on most
+// GPUs. It also stands in for how many recently transformed vertices a vertex stage can be expected to reuse.
+const int VERTEX_CACHE_SIZE = 16;
+
+// How well an index buffer reuses recently transformed vertices
+struct VertexCacheStats
+{
+    // Average cache miss ratio: vertices transformed per triangle. 3 is the worst possible value, and around 0.5 the
+    // best a regular mesh can get, since it has about half as many vertices as triangles.
+    float ACMR = 0.0f;
+    // Average transform to vertex ratio: vertices transformed per vertex used. 1 is perfect, every vertex transformed
+    // exactly once.
+    float ATVR = 0.0f;
+};
+
+// What Model::OptimizeMesh does besides ordering the triangles for the vertex cache
+struct MeshOptimizationOptions
+{
+    // Also order the triangles roughly front to back, at a small cost in vertex reuse
+    bool SortFrontToBack = false;
+    // The direction the camera looks in, in model space. Larger z is closer, so the default camera looks down -z.
+    glm::vec3 ViewDirection = glm::vec3(0.0f, 0.0f, -1.0f);
+};
+
+// The vertex cache behaviour of a mesh before and after optimizing it
+struct MeshOptimizationStats
+{
+    VertexCacheStats Before;
+    VertexCacheStats After;
+};
+
+// Runs the indices (three per triangle) through a simulated FIFO cache of cacheSize entries
+VertexCacheStats AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, int numVertices,
+                                    int cacheSize = VERTEX_CACHE_SIZE);
+
+// The optimizations below return a new order for the triangles rather than reordering them in place, as a list of the
+// original triangle numbers, so that anything else stored per triangle can be put in the same order
+
+// Orders the triangles so that consecutive triangles share as many vertices as possible, with the algorithm from Tom
+// Forsyth's "Linear-Speed Vertex Cache Optimisation". Triangles are added greedily, always picking the one whose
+// vertices score best, where vertices score higher the more recently they were used and the fewer triangles they have
+// left, so that the mesh gets finished off in patches rather than leaving stragglers behind.
+std::vector<int> OptimizeVertexCache(const std::vector<std::uint32_t>& indices, int numVertices);
+
+// Orders the triangles of an index buffer that has gone through OptimizeVertexCache roughly front to back, as seen
+// looking along viewDirection. The buffer is cut into clusters where that costs little vertex reuse, and the clusters
+// are then sorted by the depth of their centers. threshold is how much worse the ACMR of a cluster may get by starting
+// with an empty cache, where larger values give smaller clusters and a more accurate order. With a depth test, drawing
+// near surfaces first means far ones mostly fail it before getting shaded.
+std::vector<int> OptimizeOverdraw(const std::vector<std::uint32_t>& indices, Span<const Vertex> vertices,
+                                  const glm::vec3& viewDirection, float threshold = 1.05f);
+
+// Puts the triangles of an index buffer in the order returned by one of the optimizations above
+void ReorderTriangles(std::vector<std::uint32_t>& indices, const std::vector<int>& triangleOrder);
+
+// Renumbers the vertices in the order the index buffer first uses them, so that the vertex stage reads them more or
+// less sequentially. Rewrites the indices to match.
+void OptimizeVertexFetch(std::vector<std::uint32_t>& indices, std::vector<Vertex>& vertices);
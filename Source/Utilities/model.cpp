@@ -1,10 +1,165 @@
 #include "model.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 #include <tinyobjloader/tiny_obj_loader.h>
 
-Model::Model(const std::string& filename) : m_Vertices(), m_Faces()
+#include "Utilities/meshcache.h"
+#include "Utilities/objparser.h"
+
+Model::Model(const std::string& filename, const ModelLoadOptions& options)
+{
+    bool isFromMeshCache = LoadMeshCache(filename, options);
+    if (!isFromMeshCache)
+    {
+        ParseObj(filename);
+        WeldVertices();
+
+        // Optimized before saving, so that the cache has the optimized mesh for the next time
+        if (options.OptimizeMesh)
+        {
+            OptimizeMesh(options.Optimization);
+        }
+        SaveMeshCache(filename);
+    }
+
+    PrintCounts(filename, isFromMeshCache);
+
+    if (options.BuildSoALayout)
+    {
+        BuildSoALayout();
+    }
+}
+
+Model::Model(const std::string& filename, ThreadPool& threadPool, const ModelLoadOptions& options)
+{
+    bool isFromMeshCache = LoadMeshCache(filename, options);
+    if (!isFromMeshCache)
+    {
+        ParseObj(filename, threadPool);
+        WeldVertices();
+
+        // Optimized before saving, so that the cache has the optimized mesh for the next time
+        if (options.OptimizeMesh)
+        {
+            OptimizeMesh(options.Optimization);
+        }
+        SaveMeshCache(filename);
+    }
+
+    PrintCounts(filename, isFromMeshCache);
+
+    if (options.BuildSoALayout)
+    {
+        BuildSoALayout();
+    }
+}
+
+Model::~Model() {}
+
+// Whether a mesh optimized with the options a, or not at all, is what optimizing it as the load options b ask for gives
+static bool IsSameOptimization(bool isOptimized, const MeshOptimizationOptions& a, const ModelLoadOptions& b)
+{
+    if (isOptimized != b.OptimizeMesh)
+    {
+        return false;
+    }
+
+    // The view direction only matters when sorting by it
+    return !isOptimized || (a.SortFrontToBack == b.Optimization.SortFrontToBack &&
+                            (!a.SortFrontToBack || a.ViewDirection == b.Optimization.ViewDirection));
+}
+
+bool Model::LoadMeshCache(const std::string& filename, const ModelLoadOptions& options)
+{
+    MeshCacheContents contents;
+
+    if (!m_MeshCache.Open(filename + MESH_CACHE_EXTENSION))
+    {
+        return false;
+    }
+
+    if (!ReadMeshCache(m_MeshCache, filename, contents))
+    {
+        std::cout << "Mesh cache of " << filename << " is out of date or invalid, reloading\n";
+        m_MeshCache.Close();
+        return false;
+    }
+
+    // The order of the faces an optimized cache was made with is gone, so it can't be optimized differently
+    if (!IsSameOptimization(contents.IsOptimized, contents.OptimizationOptions, options))
+    {
+        std::cout << "Mesh cache of " << filename << " is optimized differently, reloading\n";
+        m_MeshCache.Close();
+        return false;
+    }
+
+    m_IsOptimized         = contents.IsOptimized;
+    m_OptimizationOptions = contents.OptimizationOptions;
+    m_OptimizationStats   = contents.OptimizationStats;
+
+    m_Vertices       = contents.Vertices;
+    m_Normals        = contents.Normals;
+    m_TexCoords      = contents.TexCoords;
+    m_Faces          = contents.Faces;
+    m_WeldedVertices = contents.WeldedVertices;
+
+    if (!contents.Indices16.empty())
+    {
+        m_Indices.Reference(contents.Indices16);
+    }
+    else
+    {
+        m_Indices.Reference(contents.Indices32);
+    }
+
+    m_Materials = std::move(contents.Materials);
+    m_DrawBatches.assign(contents.DrawBatches.begin(), contents.DrawBatches.end());
+
+    m_WeldStats.NumCorners        = static_cast<int>(m_Faces.size() * 3);
+    m_WeldStats.NumPositions      = static_cast<int>(m_Vertices.size());
+    m_WeldStats.NumNormals        = static_cast<int>(m_Normals.size());
+    m_WeldStats.NumTexCoords      = static_cast<int>(m_TexCoords.size());
+    m_WeldStats.NumWeldedVertices = static_cast<int>(m_WeldedVertices.size());
+
+    return true;
+}
+
+void Model::SaveMeshCache(const std::string& filename) const
+{
+    MeshCacheSource source;
+    if (!GetMeshCacheSource(filename, m_MaterialLibraries, source))
+    {
+        return;
+    }
+
+    MeshCacheContents contents;
+    contents.Vertices            = m_Vertices;
+    contents.Normals             = m_Normals;
+    contents.TexCoords           = m_TexCoords;
+    contents.Faces               = m_Faces;
+    contents.WeldedVertices      = m_WeldedVertices;
+    contents.Indices16           = m_Indices.GetIndices16();
+    contents.Indices32           = m_Indices.GetIndices32();
+    contents.DrawBatches         = m_DrawBatches;
+    contents.Materials           = m_Materials;
+    contents.IsOptimized         = m_IsOptimized;
+    contents.OptimizationOptions = m_OptimizationOptions;
+    contents.OptimizationStats   = m_OptimizationStats;
+
+    // Not being able to write the cache only costs time on the next load
+    if (!WriteMeshCache(filename + MESH_CACHE_EXTENSION, source, contents))
+    {
+        std::cerr << "Failed to write the mesh cache of " << filename << "\n";
+    }
+}
+
+void Model::ParseObj(const std::string& filename)
 {
     tinyobj::ObjReader reader;
 
@@ -26,38 +181,381 @@ Model::Model(const std::string& filename) : m_Vertices(), m_Faces()
     const std::vector<tinyobj::shape_t>&    shapes    = reader.GetShapes();
     const std::vector<tinyobj::material_t>& materials = reader.GetMaterials();
 
-    for (size_t i = 0; i < attrib.vertices.size(); i += 3)
+    // tinyobjloader keeps every attribute as one flat array of floats, laid out the same as an array of glm vectors, so
+    // each one is a single copy instead of a push_back per element
+    static_assert(std::is_same<tinyobj::real_t, float>::value, "tinyobjloader is built with double precision");
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::vec2) == 2 * sizeof(float),
+                  "glm vectors are not tightly packed");
+
+    auto copyAttribute = [](const std::vector<float>& source, auto& destination) {
+        using Vector = typename std::decay_t<decltype(destination)>::value_type;
+
+        destination.resize(source.size() * sizeof(float) / sizeof(Vector));
+        std::memcpy(static_cast<void*>(destination.data()), source.data(), destination.size() * sizeof(Vector));
+    };
+
+    // tinyobjloader doesn't say which material libraries it read, which the mesh cache needs to know
+    m_MaterialLibraries = FindObjMaterialLibraries(filename);
+
+    copyAttribute(attrib.vertices, m_VertexStorage);
+    copyAttribute(attrib.normals, m_NormalStorage);
+    copyAttribute(attrib.texcoords, m_TexCoordStorage);
+
+    size_t numFaces = 0;
+    for (const tinyobj::shape_t& shape : shapes)
     {
-        m_Vertices.push_back(glm::vec3(attrib.vertices[i], attrib.vertices[i + 1], attrib.vertices[i + 2]));
+        numFaces += shape.mesh.indices.size() / 3;
     }
-    for (size_t i = 0; i < attrib.normals.size(); i += 3)
+
+    std::vector<int> faceMaterials;
+    faceMaterials.reserve(numFaces);
+    m_FaceStorage.reserve(numFaces);
+
+    for (const tinyobj::shape_t& shape : shapes)
     {
-        m_Normals.push_back(glm::vec3(attrib.normals[i], attrib.normals[i + 1], attrib.normals[i + 2]));
+        for (size_t i = 0; i < shape.mesh.indices.size(); i += 3)
+        {
+            tinyobj::index_t i1 = shape.mesh.indices[i];
+            tinyobj::index_t i2 = shape.mesh.indices[i + 1];
+            tinyobj::index_t i3 = shape.mesh.indices[i + 2];
+
+            Index index1 = {i1.vertex_index, i1.normal_index, i1.texcoord_index};
+            Index index2 = {i2.vertex_index, i2.normal_index, i2.texcoord_index};
+            Index index3 = {i3.vertex_index, i3.normal_index, i3.texcoord_index};
+
+            m_FaceStorage.push_back({index1, index2, index3});
+            faceMaterials.push_back(shape.mesh.material_ids[i / 3]);
+        }
     }
-    for (size_t i = 0; i < attrib.texcoords.size(); i += 2)
+
+    m_Materials.reserve(materials.size() + 1);
+    for (const tinyobj::material_t& material : materials)
     {
-        m_TexCoords.push_back(glm::vec2(attrib.texcoords[i], attrib.texcoords[i + 1]));
+        m_Materials.push_back({material.name, material.diffuse_texname});
     }
-    for (size_t i = 0; i < shapes[0].mesh.indices.size(); i += 3)
+
+    BuildDrawBatches(faceMaterials);
+    UpdateViews();
+}
+
+void Model::ParseObj(const std::string& filename, ThreadPool& threadPool)
+{
+    ObjData     data;
+    std::string error;
+
+    if (!ParseObjParallel(filename, threadPool, data, error))
     {
-        tinyobj::index_t i1 = shapes[0].mesh.indices[i];
-        tinyobj::index_t i2 = shapes[0].mesh.indices[i + 1];
-        tinyobj::index_t i3 = shapes[0].mesh.indices[i + 2];
+        std::cerr << "ObjParser: " << error << "\n";
+        exit(1);
+    }
+
+    m_VertexStorage   = std::move(data.Vertices);
+    m_NormalStorage   = std::move(data.Normals);
+    m_TexCoordStorage = std::move(data.TexCoords);
 
-        Index index1 = {i1.vertex_index, i1.normal_index, i1.texcoord_index};
-        Index index2 = {i2.vertex_index, i2.normal_index, i2.texcoord_index};
-        Index index3 = {i3.vertex_index, i3.normal_index, i3.texcoord_index};
+    m_MaterialLibraries = std::move(data.MaterialLibraries);
 
-        m_Faces.push_back({index1, index2, index3});
+    // The shapes are consecutive runs of the faces, so taking all of them is taking all of the faces
+    m_FaceStorage = std::move(data.Faces);
+
+    m_Materials.reserve(data.Materials.size() + 1);
+    for (ObjMaterial& material : data.Materials)
+    {
+        m_Materials.push_back({std::move(material.Name), std::move(material.DiffuseTextureName)});
     }
 
-    m_Material.DiffuseTextureName = materials[0].diffuse_texname;
+    BuildDrawBatches(data.FaceMaterials);
+    UpdateViews();
+}
 
-    std::cout << "Model: " << filename << "\n";
+void Model::PrintCounts(const std::string& filename, bool isFromMeshCache) const
+{
+    std::cout << "Model: " << filename << (isFromMeshCache ? " (from mesh cache)" : "") << "\n";
     std::cout << "Vertices: " << m_Vertices.size() << "\n";
     std::cout << "Normals: " << m_Normals.size() << "\n";
     std::cout << "TexCoords: " << m_TexCoords.size() << "\n";
     std::cout << "Faces: " << m_Faces.size() << "\n";
+    std::cout << "Welded vertices: " << m_WeldStats.NumWeldedVertices << " (from " << m_WeldStats.NumCorners
+              << " face corners), " << (m_Indices.Is16Bit() ? 16 : 32) << " bit indices\n";
 }
 
-Model::~Model() {}
+void Model::BuildDrawBatches(const std::vector<int>& faceMaterials)
+{
+    // Faces without a material, or with one that doesn't exist, get an extra material of their own
+    int numMaterials    = static_cast<int>(m_Materials.size());
+    int defaultMaterial = numMaterials;
+
+    auto getMaterial = [&](size_t face) {
+        int material = faceMaterials[face];
+        return material >= 0 && material < numMaterials ? material : defaultMaterial;
+    };
+
+    // Most files already have the faces of every material together, in which case they don't need to move at all
+    std::vector<int> numFaces(numMaterials + 1, 0);
+    bool             isSorted = true;
+
+    for (size_t face = 0; face < m_FaceStorage.size(); face++)
+    {
+        int material = getMaterial(face);
+        numFaces[material]++;
+        isSorted = isSorted && (face == 0 || getMaterial(face - 1) <= material);
+    }
+
+    if (numFaces[defaultMaterial] > 0)
+    {
+        m_Materials.push_back({"", ""});
+    }
+
+    // A counting sort, which keeps the faces of every material in file order
+    m_DrawBatches.clear();
+    std::vector<int> nextFace(numMaterials + 1);
+    int              firstFace = 0;
+
+    for (int material = 0; material <= numMaterials; material++)
+    {
+        nextFace[material] = firstFace;
+        if (numFaces[material] > 0)
+        {
+            m_DrawBatches.push_back({material, firstFace, numFaces[material]});
+        }
+        firstFace += numFaces[material];
+    }
+
+    if (isSorted)
+    {
+        return;
+    }
+
+    std::vector<Face> sortedFaces(m_FaceStorage.size());
+    for (size_t face = 0; face < m_FaceStorage.size(); face++)
+    {
+        sortedFaces[nextFace[getMaterial(face)]++] = m_FaceStorage[face];
+    }
+    m_FaceStorage.swap(sortedFaces);
+}
+
+void Model::CopyFromMeshCache()
+{
+    if (!m_MeshCache.IsOpen())
+    {
+        return;
+    }
+
+    m_VertexStorage.assign(m_Vertices.begin(), m_Vertices.end());
+    m_NormalStorage.assign(m_Normals.begin(), m_Normals.end());
+    m_TexCoordStorage.assign(m_TexCoords.begin(), m_TexCoords.end());
+    m_FaceStorage.assign(m_Faces.begin(), m_Faces.end());
+    m_WeldedVertexStorage.assign(m_WeldedVertices.begin(), m_WeldedVertices.end());
+
+    std::vector<std::uint32_t> indices(m_Indices.GetSize());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        indices[i] = m_Indices[i];
+    }
+    m_Indices.Assign(std::move(indices), static_cast<std::uint32_t>(m_WeldedVertexStorage.size()));
+
+    UpdateViews();
+    m_MeshCache.Close();
+}
+
+void Model::UpdateViews()
+{
+    m_Vertices       = m_VertexStorage;
+    m_Normals        = m_NormalStorage;
+    m_TexCoords      = m_TexCoordStorage;
+    m_Faces          = m_FaceStorage;
+    m_WeldedVertices = m_WeldedVertexStorage;
+}
+
+void Model::WeldVertices()
+{
+    // Vertices are compared by the exact bits of their attributes, which also merges corners the file happened to give
+    // different indices to despite having the same values
+    auto hashVertex = [](const Vertex& vertex) {
+        std::uint32_t bits[8];
+        std::memcpy(bits, &vertex, sizeof(bits));
+
+        std::size_t hash = 0;
+        for (std::uint32_t word : bits)
+        {
+            hash = hash * 0x100000001b3ull ^ word;
+        }
+        return hash;
+    };
+    auto isSameVertex = [](const Vertex& a, const Vertex& b) { return std::memcmp(&a, &b, sizeof(Vertex)) == 0; };
+
+    static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex is hashed as 8 floats without padding");
+
+    // The table is sized for one vertex per corner so that it never has to rehash, but the vertices themselves
+    // usually number about as many as the values of the attribute with the most of them, far fewer than the corners
+    std::unordered_map<Vertex, std::uint32_t, decltype(hashVertex), decltype(isSameVertex)> vertexToIndex(
+        m_Faces.size() * 3, hashVertex, isSameVertex);
+
+    std::vector<std::uint32_t> indices;
+    indices.reserve(m_Faces.size() * 3);
+    m_WeldedVertexStorage.clear();
+    m_WeldedVertexStorage.reserve(std::max({m_Vertices.size(), m_Normals.size(), m_TexCoords.size()}));
+
+    for (const Face& face : m_Faces)
+    {
+        for (const Index& corner : face)
+        {
+            // Corners can leave out their normal or texture coordinate, which the loaders mark with an index of -1
+            Vertex vertex;
+            vertex.Position = m_Vertices[corner.VertexIndex];
+            vertex.Normal   = corner.NormalIndex >= 0 ? m_Normals[corner.NormalIndex] : glm::vec3(0.0f);
+            vertex.TexCoord = corner.TexCoordIndex >= 0 ? m_TexCoords[corner.TexCoordIndex] : glm::vec2(0.0f);
+
+            auto inserted = vertexToIndex.emplace(vertex, static_cast<std::uint32_t>(m_WeldedVertexStorage.size()));
+            if (inserted.second)
+            {
+                m_WeldedVertexStorage.push_back(vertex);
+            }
+            indices.push_back(inserted.first->second);
+        }
+    }
+
+    UpdateViews();
+    m_Indices.Assign(std::move(indices), static_cast<std::uint32_t>(m_WeldedVertices.size()));
+
+    m_WeldStats.NumCorners        = static_cast<int>(m_Faces.size() * 3);
+    m_WeldStats.NumPositions      = static_cast<int>(m_Vertices.size());
+    m_WeldStats.NumNormals        = static_cast<int>(m_Normals.size());
+    m_WeldStats.NumTexCoords      = static_cast<int>(m_TexCoords.size());
+    m_WeldStats.NumWeldedVertices = static_cast<int>(m_WeldedVertices.size());
+}
+
+void Model::BuildSoALayout()
+{
+    int    numVertices = static_cast<int>(m_WeldedVertices.size());
+    size_t paddedSize  = (numVertices + SOA_VERTEX_PADDING - 1) / SOA_VERTEX_PADDING * SOA_VERTEX_PADDING;
+
+    AlignedVector<float>* arrays[] = {&m_SoAVertices.PositionX, &m_SoAVertices.PositionY, &m_SoAVertices.PositionZ,
+                                      &m_SoAVertices.NormalX,   &m_SoAVertices.NormalY,   &m_SoAVertices.NormalZ,
+                                      &m_SoAVertices.TexCoordU, &m_SoAVertices.TexCoordV};
+    for (AlignedVector<float>* array : arrays)
+    {
+        array->assign(paddedSize, 0.0f);
+    }
+
+    for (int i = 0; i < numVertices; i++)
+    {
+        const Vertex& vertex = m_WeldedVertices[i];
+
+        m_SoAVertices.PositionX[i] = vertex.Position.x;
+        m_SoAVertices.PositionY[i] = vertex.Position.y;
+        m_SoAVertices.PositionZ[i] = vertex.Position.z;
+        m_SoAVertices.NormalX[i]   = vertex.Normal.x;
+        m_SoAVertices.NormalY[i]   = vertex.Normal.y;
+        m_SoAVertices.NormalZ[i]   = vertex.Normal.z;
+        m_SoAVertices.TexCoordU[i] = vertex.TexCoord.x;
+        m_SoAVertices.TexCoordV[i] = vertex.TexCoord.y;
+    }
+
+    m_SoAVertices.NumVertices = numVertices;
+}
+
+MeshOptimizationStats Model::OptimizeMesh(const MeshOptimizationOptions& options)
+{
+    CopyFromMeshCache();
+
+    int numVertices = static_cast<int>(m_WeldedVertices.size());
+
+    std::vector<std::uint32_t> indices(m_Indices.GetSize());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        indices[i] = m_Indices[i];
+    }
+
+    MeshOptimizationStats stats;
+    stats.Before = AnalyzeVertexCache(indices, numVertices);
+
+    // Every batch is optimized on its own, so that its faces stay together. Its vertices are numbered from 0 while it
+    // is, so that the optimizations only deal with the vertices it uses rather than with every vertex of the mesh.
+    std::vector<int> triangleOrder;
+    triangleOrder.reserve(m_FaceStorage.size());
+
+    const std::uint32_t        NOT_IN_BATCH = 0xffffffff;
+    std::vector<std::uint32_t> batchVertexIndices(numVertices, NOT_IN_BATCH);
+    std::vector<std::uint32_t> meshVertexIndices;
+    std::vector<Vertex>        batchVertices;
+
+    for (const DrawBatch& batch : m_DrawBatches)
+    {
+        std::vector<std::uint32_t> batchIndices(indices.begin() + batch.FirstFace * 3,
+                                                indices.begin() + (batch.FirstFace + batch.NumFaces) * 3);
+
+        meshVertexIndices.clear();
+        batchVertices.clear();
+        for (std::uint32_t& index : batchIndices)
+        {
+            if (batchVertexIndices[index] == NOT_IN_BATCH)
+            {
+                batchVertexIndices[index] = static_cast<std::uint32_t>(meshVertexIndices.size());
+                meshVertexIndices.push_back(index);
+                batchVertices.push_back(m_WeldedVertexStorage[index]);
+            }
+            index = batchVertexIndices[index];
+        }
+
+        std::vector<int> batchOrder = OptimizeVertexCache(batchIndices, static_cast<int>(batchVertices.size()));
+        ReorderTriangles(batchIndices, batchOrder);
+
+        if (options.SortFrontToBack)
+        {
+            // The new order is relative to the one the vertex cache optimization just put the triangles in
+            std::vector<int> overdrawOrder = OptimizeOverdraw(batchIndices, batchVertices, options.ViewDirection);
+            ReorderTriangles(batchIndices, overdrawOrder);
+
+            for (int& triangle : overdrawOrder)
+            {
+                triangle = batchOrder[triangle];
+            }
+            batchOrder.swap(overdrawOrder);
+        }
+
+        // Back to the numbers of the mesh, leaving the map empty for the next batch
+        for (std::uint32_t& index : batchIndices)
+        {
+            index = meshVertexIndices[index];
+        }
+        for (std::uint32_t vertex : meshVertexIndices)
+        {
+            batchVertexIndices[vertex] = NOT_IN_BATCH;
+        }
+
+        std::copy(batchIndices.begin(), batchIndices.end(), indices.begin() + batch.FirstFace * 3);
+        for (int triangle : batchOrder)
+        {
+            triangleOrder.push_back(batch.FirstFace + triangle);
+        }
+    }
+
+    // The faces follow the triangles, so that they keep matching the index buffer
+    std::vector<Face> faces;
+    faces.reserve(m_FaceStorage.size());
+    for (int triangle : triangleOrder)
+    {
+        faces.push_back(m_FaceStorage[triangle]);
+    }
+    m_FaceStorage.swap(faces);
+
+    // Vertices no face uses get dropped along the way, so the count changes
+    OptimizeVertexFetch(indices, m_WeldedVertexStorage);
+    UpdateViews();
+    numVertices                   = static_cast<int>(m_WeldedVertexStorage.size());
+    m_WeldStats.NumWeldedVertices = numVertices;
+    stats.After                   = AnalyzeVertexCache(indices, numVertices);
+
+    m_Indices.Assign(std::move(indices), static_cast<std::uint32_t>(numVertices));
+
+    if (HasSoALayout())
+    {
+        BuildSoALayout();
+    }
+
+    m_IsOptimized         = true;
+    m_OptimizationOptions = options;
+    m_OptimizationStats   = stats;
+    return stats;
+}
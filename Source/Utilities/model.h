@@ -3,22 +3,33 @@
 #include "glm/glm.hpp"
 
 #include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 
-struct Texture
-{
-    unsigned char* Data;
-    int            Width;
-    int            Height;
-    int            NumComponents;
-};
+#include "Utilities/alignedallocator.h"
+#include "Utilities/indexbuffer.h"
+#include "Utilities/mappedfile.h"
+#include "Utilities/meshoptimizer.h"
+#include "Utilities/span.h"
+
+class ThreadPool;
 
 struct Material
 {
+    std::string Name;
     std::string DiffuseTextureName;
 };
 
+// A run of consecutive faces that all use the same material. The faces of a model are sorted by material, so every
+// material has exactly one batch, and a renderer can bind its texture once and draw all of its faces together.
+struct DrawBatch
+{
+    int MaterialIndex;
+    int FirstFace;
+    int NumFaces;
+};
+
 struct Index
 {
     int VertexIndex;
@@ -28,24 +39,163 @@ struct Index
 
 using Face = std::array<Index, 3>;
 
+// A vertex with all of its attributes side by side, as produced by welding
+struct Vertex
+{
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoord;
+};
+
+// The size of the mesh before and after welding
+struct WeldStats
+{
+    // Three per face, the number of vertices the mesh would have without any sharing
+    int NumCorners   = 0;
+    int NumPositions = 0;
+    int NumNormals   = 0;
+    int NumTexCoords = 0;
+    // Distinct (position, normal, texture coordinate) combinations, each one becoming a single welded vertex
+    int NumWeldedVertices = 0;
+};
+
+// The number of floats the arrays of a SoAVertexBuffer are padded to a multiple of, the width of an AVX-512 register
+const int SOA_VERTEX_PADDING = 16;
+
+// The vertices of a model in structure of arrays form: every component of every attribute in its own array, so that
+// a kernel can load the same component of several consecutive vertices into one SIMD register. Every array starts on
+// a 64 byte boundary and is padded with zeros up to a multiple of SOA_VERTEX_PADDING, so kernels never need a scalar
+// loop for the last few vertices.
+struct SoAVertexBuffer
+{
+    AlignedVector<float> PositionX;
+    AlignedVector<float> PositionY;
+    AlignedVector<float> PositionZ;
+    AlignedVector<float> NormalX;
+    AlignedVector<float> NormalY;
+    AlignedVector<float> NormalZ;
+    AlignedVector<float> TexCoordU;
+    AlignedVector<float> TexCoordV;
+
+    // The number of actual vertices, not counting the padding
+    int NumVertices = 0;
+};
+
+// What a model does once its mesh is loaded, before anyone gets to use it
+struct ModelLoadOptions
+{
+    // Optimize the mesh with the options below, see Model::OptimizeMesh
+    bool                    OptimizeMesh = false;
+    MeshOptimizationOptions Optimization = {};
+    // Build the SoA layout, see Model::BuildSoALayout
+    bool BuildSoALayout = false;
+};
+
 class Model
 {
 
   public:
-    Model(const std::string& filename);
+    // Loads the model from its mesh cache if there is an up to date one next to the file, and otherwise parses the
+    // file and writes the cache for the next time. Does whatever the options ask for while loading, so that a model
+    // shared between several users never has to change after it is loaded. The cache keeps the optimized mesh, and is
+    // only used if it was optimized with the same options.
+    Model(const std::string& filename, const ModelLoadOptions& options = {});
+    // Same, but parses the file with the multithreaded parser of objparser.h, spread over the pool, instead of
+    // tinyobjloader. Much faster for large files.
+    Model(const std::string& filename, ThreadPool& threadPool, const ModelLoadOptions& options = {});
     ~Model();
-    inline int       GetNumVertices() const { return static_cast<int>(m_Vertices.size()); }
-    inline int       GetNumFaces() const { return static_cast<int>(m_Faces.size()); }
-    inline glm::vec3 GetVertexAtIndex(int index) const { return m_Vertices[index]; }
-    inline glm::vec2 GetTexCoordAtIndex(int index) const { return m_TexCoords[index]; }
-    inline glm::vec3 GetNormalAtIndex(int index) const { return m_Normals[index]; }
-    inline Face      GetFaceAtIndex(int index) const { return m_Faces[index]; }
-    inline Material  GetMaterial() const { return m_Material; }
+    inline int              GetNumVertices() const { return static_cast<int>(m_Vertices.size()); }
+    inline int              GetNumFaces() const { return static_cast<int>(m_Faces.size()); }
+    inline const glm::vec3& GetVertexAtIndex(int index) const { return m_Vertices[index]; }
+    inline const glm::vec2& GetTexCoordAtIndex(int index) const { return m_TexCoords[index]; }
+    inline const glm::vec3& GetNormalAtIndex(int index) const { return m_Normals[index]; }
+    inline const Face&      GetFaceAtIndex(int index) const { return m_Faces[index]; }
+    inline int              GetNumMaterials() const { return static_cast<int>(m_Materials.size()); }
+    inline const Material&  GetMaterial(int index) const { return m_Materials[index]; }
+
+    inline const std::vector<Material>& GetMaterials() const { return m_Materials; }
+
+    // The faces of every shape in the file, grouped by material. Faces without a material get one with no texture,
+    // added after the ones from the file.
+    inline const std::vector<DrawBatch>& GetDrawBatches() const { return m_DrawBatches; }
+
+    // The whole attribute streams, for processing every vertex or face in one go without copying any of them. They
+    // point either into the model itself or into its mapped mesh cache.
+    inline Span<const glm::vec3> GetVertices() const { return m_Vertices; }
+    inline Span<const glm::vec3> GetNormals() const { return m_Normals; }
+    inline Span<const glm::vec2> GetTexCoords() const { return m_TexCoords; }
+    inline Span<const Face>      GetFaces() const { return m_Faces; }
+
+    // The mesh as a single stream of welded vertices, and three indices into it per face in the same order as the
+    // faces. Built while loading: every distinct combination of position, normal and texture coordinate values becomes
+    // one vertex, no matter how many face corners share it or which indices the file used for it.
+    inline Span<const Vertex> GetWeldedVertices() const { return m_WeldedVertices; }
+    inline const IndexBuffer& GetIndices() const { return m_Indices; }
+    inline const WeldStats&   GetWeldStats() const { return m_WeldStats; }
+
+    // Whether the model was loaded from its mesh cache rather than parsed
+    inline bool IsFromMeshCache() const { return m_MeshCache.IsOpen(); }
+
+    // Reorders the faces and the index buffer of every draw batch for the post-transform vertex cache, and optionally
+    // roughly front to back, then renumbers the welded vertices in the order the new index buffer uses them. The
+    // batches stay where they are. Rebuilds the SoA layout if there is one. Optional, since the file order is often
+    // good enough already and the reordering takes a while. A model loaded from its mesh cache gets copied out of it
+    // first.
+    MeshOptimizationStats OptimizeMesh(const MeshOptimizationOptions& options);
+
+    // What the last OptimizeMesh did, which stays all zeros for a model that was never optimized
+    inline const MeshOptimizationStats& GetOptimizationStats() const { return m_OptimizationStats; }
+
+    // Builds the optional SoA layout of the welded vertices, which GetIndices indexes as well
+    void BuildSoALayout();
+
+    inline bool                   HasSoALayout() const { return m_SoAVertices.NumVertices > 0; }
+    inline const SoAVertexBuffer& GetSoAVertices() const { return m_SoAVertices; }
 
   private:
-    std::vector<glm::vec3> m_Vertices;
-    std::vector<glm::vec3> m_Normals;
-    std::vector<glm::vec2> m_TexCoords;
-    std::vector<Face>      m_Faces;
-    Material               m_Material;
+    bool LoadMeshCache(const std::string& filename, const ModelLoadOptions& options);
+    void SaveMeshCache(const std::string& filename) const;
+    void ParseObj(const std::string& filename);
+    void ParseObj(const std::string& filename, ThreadPool& threadPool);
+    void PrintCounts(const std::string& filename, bool isFromMeshCache) const;
+    // Sorts the faces by material, given the material of every face, and builds the draw batches
+    void BuildDrawBatches(const std::vector<int>& faceMaterials);
+    void WeldVertices();
+
+    // Copies whatever is still in the mesh cache into the model itself, to be able to modify it
+    void CopyFromMeshCache();
+    // Points the views at the storage of the model
+    void UpdateViews();
+
+    // What all of the accessors read from
+    Span<const glm::vec3> m_Vertices;
+    Span<const glm::vec3> m_Normals;
+    Span<const glm::vec2> m_TexCoords;
+    Span<const Face>      m_Faces;
+    Span<const Vertex>    m_WeldedVertices;
+    IndexBuffer           m_Indices;
+    WeldStats             m_WeldStats;
+
+    // What the last OptimizeMesh did, if anything
+    bool                    m_IsOptimized = false;
+    MeshOptimizationOptions m_OptimizationOptions;
+    MeshOptimizationStats   m_OptimizationStats;
+
+    std::vector<Material>  m_Materials;
+    std::vector<DrawBatch> m_DrawBatches;
+
+    // The material libraries of a model that was parsed, for its mesh cache to depend on
+    std::vector<std::string> m_MaterialLibraries;
+
+    // The storage of a model that was parsed, or modified after being loaded from the cache. Empty while the views
+    // point into the cache.
+    std::vector<glm::vec3> m_VertexStorage;
+    std::vector<glm::vec3> m_NormalStorage;
+    std::vector<glm::vec2> m_TexCoordStorage;
+    std::vector<Face>      m_FaceStorage;
+    std::vector<Vertex>    m_WeldedVertexStorage;
+
+    MappedFile m_MeshCache;
+
+    SoAVertexBuffer m_SoAVertices;
 };
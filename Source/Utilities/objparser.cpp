@@ -0,0 +1,686 @@
+#include "objparser.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+#include "Utilities/mappedfile.h"
+
+// Chunks are at least this large, so that small files don't get spread over threads for nothing
+const size_t OBJ_MIN_CHUNK_SIZE = 1 << 20;
+
+// The number of chunks per thread of the pool, so that a chunk that happens to be slow to parse doesn't hold up the
+// others for long
+const int OBJ_CHUNKS_PER_THREAD = 4;
+
+// What an index that can't refer to anything resolves to, such as an index of 0. Lower than -1, which means that the
+// attribute is left out, so that the range check after stitching rejects it.
+const int OBJ_INVALID_INDEX = std::numeric_limits<int>::min();
+
+// An index written relative to the end of its attribute list, like -1 for the last vertex so far. Within a chunk it
+// can only be resolved relative to the start of the chunk, so it gets fixed up once the chunks are stitched together.
+struct RelativeIndex
+{
+    size_t Face;
+    // The corner of the face, or of the polygon while it is being split into faces
+    int Corner;
+    // 0 for the vertex, 1 for the normal and 2 for the texture coordinate
+    int Attribute;
+};
+
+// A record that changes the state of everything after it, which may be in later chunks
+struct ObjStateChange
+{
+    // The number of faces in the chunk before the change
+    size_t      Face;
+    std::string Name;
+};
+
+// What a chunk contains, with indices relative to the start of the chunk where they can't be known yet
+struct ObjChunk
+{
+    std::vector<glm::vec3>      Vertices;
+    std::vector<glm::vec3>      Normals;
+    std::vector<glm::vec2>      TexCoords;
+    std::vector<Face>           Faces;
+    std::vector<RelativeIndex>  RelativeIndices;
+    std::vector<ObjStateChange> ShapeChanges;
+    std::vector<ObjStateChange> MaterialChanges;
+    // The names on every mtllib record
+    std::vector<std::vector<std::string>> MaterialLibraries;
+
+    // Reused for every face, to not allocate anything per face
+    std::vector<Index>         PolygonCorners;
+    std::vector<RelativeIndex> PolygonRelativeIndices;
+};
+
+static inline bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline const char* SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && IsSpace(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+// The rest of the line without the whitespace around it
+static std::string GetName(const char* p, const char* end)
+{
+    p = SkipSpaces(p, end);
+    while (end > p && IsSpace(end[-1]))
+    {
+        end--;
+    }
+    return std::string(p, end);
+}
+
+// The whitespace separated names on the rest of the line
+static std::vector<std::string> GetNames(const char* p, const char* end)
+{
+    std::vector<std::string> names;
+    while ((p = SkipSpaces(p, end)) < end)
+    {
+        const char* nameStart = p;
+        while (p < end && !IsSpace(*p))
+        {
+            p++;
+        }
+        names.emplace_back(nameStart, p);
+    }
+    return names;
+}
+
+// Every power of ten a double represents exactly
+static const double s_PowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Parses a float starting at p and moves p past it. When the digits fit in the 53 bit mantissa of a double and the
+// exponent is small enough for its power of ten to be exact, one multiplication or division gives the correctly
+// rounded double, which covers virtually every number in an OBJ file. Anything else falls back to strtod.
+static float ParseFloat(const char*& p, const char* end)
+{
+    const char* start = p;
+
+    bool isNegative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        isNegative = *p == '-';
+        p++;
+    }
+
+    std::uint64_t mantissa  = 0;
+    int           numDigits = 0;
+    int           exponent  = 0;
+
+    while (p < end && IsDigit(*p))
+    {
+        mantissa = mantissa * 10 + (*p - '0');
+        numDigits++;
+        p++;
+    }
+
+    if (p < end && *p == '.')
+    {
+        p++;
+        while (p < end && IsDigit(*p))
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            numDigits++;
+            exponent--;
+            p++;
+        }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* exponentStart = p;
+        p++;
+
+        bool isExponentNegative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            isExponentNegative = *p == '-';
+            p++;
+        }
+
+        if (p < end && IsDigit(*p))
+        {
+            int value = 0;
+            while (p < end && IsDigit(*p))
+            {
+                value = std::min(value * 10 + (*p - '0'), 100000);
+                p++;
+            }
+            exponent += isExponentNegative ? -value : value;
+        }
+        else
+        {
+            // Not an exponent after all
+            p = exponentStart;
+        }
+    }
+
+    // 15 digits always fit in 53 bits, more may have overflowed the mantissa
+    if (numDigits <= 15 && exponent >= -22 && exponent <= 22)
+    {
+        double value = static_cast<double>(mantissa);
+        value        = exponent < 0 ? value / s_PowersOfTen[-exponent] : value * s_PowersOfTen[exponent];
+        return static_cast<float>(isNegative ? -value : value);
+    }
+
+    // strtod needs a terminated string, which the mapped file doesn't have
+    char buffer[128];
+    p           = start;
+    size_t size = 0;
+    while (p < end && !IsSpace(*p) && size < sizeof(buffer) - 1)
+    {
+        buffer[size++] = *p++;
+    }
+    buffer[size] = '\0';
+
+    return static_cast<float>(std::strtod(buffer, nullptr));
+}
+
+// Parses an integer starting at p and moves p past it. Returns 0, which no valid index is, if there is none.
+static int ParseInt(const char*& p, const char* end)
+{
+    bool isNegative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        isNegative = *p == '-';
+        p++;
+    }
+
+    // Clamped long before it can overflow, far past the number of anything in a file that fits in memory
+    int value = 0;
+    while (p < end && IsDigit(*p))
+    {
+        value = std::min(value, 100000000) * 10 + (*p - '0');
+        p++;
+    }
+
+    return isNegative ? -value : value;
+}
+
+// Turns an index as written in the file into an index into the attribute list. Positive indices count from 1 at the
+// start of the file. Negative ones count back from the end of the list so far, which is only known relative to the
+// start of the chunk for now, so they get recorded for fixing up later. Whether the index is in range can only be
+// checked once the chunks are stitched together as well.
+static int ResolveIndex(int index, size_t numInChunk, int corner, int attribute,
+                        std::vector<RelativeIndex>& relativeIndices)
+{
+    if (index > 0)
+    {
+        return index - 1;
+    }
+    if (index == 0)
+    {
+        return OBJ_INVALID_INDEX;
+    }
+
+    relativeIndices.push_back({0, corner, attribute});
+    return static_cast<int>(numInChunk) + index;
+}
+
+static void ParseFace(const char* p, const char* end, ObjChunk& chunk)
+{
+    // The corners of the polygon, and its relative indices by corner number
+    std::vector<Index>&         corners         = chunk.PolygonCorners;
+    std::vector<RelativeIndex>& relativeIndices = chunk.PolygonRelativeIndices;
+    corners.clear();
+    relativeIndices.clear();
+
+    while (true)
+    {
+        p = SkipSpaces(p, end);
+        if (p >= end || !(IsDigit(*p) || *p == '-' || *p == '+'))
+        {
+            break;
+        }
+
+        int   number = static_cast<int>(corners.size());
+        Index corner = {-1, -1, -1};
+
+        corner.VertexIndex = ResolveIndex(ParseInt(p, end), chunk.Vertices.size(), number, 0, relativeIndices);
+
+        // v, v/vt, v//vn or v/vt/vn
+        if (p < end && *p == '/')
+        {
+            p++;
+            if (p < end && *p != '/')
+            {
+                corner.TexCoordIndex =
+                    ResolveIndex(ParseInt(p, end), chunk.TexCoords.size(), number, 2, relativeIndices);
+            }
+            if (p < end && *p == '/')
+            {
+                p++;
+                corner.NormalIndex = ResolveIndex(ParseInt(p, end), chunk.Normals.size(), number, 1, relativeIndices);
+            }
+        }
+
+        corners.push_back(corner);
+
+        // Skip whatever else is attached to the corner
+        while (p < end && !IsSpace(*p))
+        {
+            p++;
+        }
+    }
+
+    // Split the polygon into a fan of triangles around its first corner
+    for (size_t i = 1; i + 1 < corners.size(); i++)
+    {
+        const size_t triangleCorners[3] = {0, i, i + 1};
+
+        for (const RelativeIndex& relative : relativeIndices)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                if (static_cast<size_t>(relative.Corner) == triangleCorners[j])
+                {
+                    chunk.RelativeIndices.push_back({chunk.Faces.size(), j, relative.Attribute});
+                }
+            }
+        }
+
+        chunk.Faces.push_back({corners[0], corners[i], corners[i + 1]});
+    }
+}
+
+static void ParseLine(const char* p, const char* end, ObjChunk& chunk)
+{
+    p = SkipSpaces(p, end);
+    if (p >= end)
+    {
+        return;
+    }
+
+    // The keyword is everything up to the first whitespace
+    const char* keyword = p;
+    while (p < end && !IsSpace(*p))
+    {
+        p++;
+    }
+    size_t keywordLength = p - keyword;
+
+    auto isKeyword = [&](const char* name) {
+        return std::strlen(name) == keywordLength && std::memcmp(keyword, name, keywordLength) == 0;
+    };
+
+    if (isKeyword("v"))
+    {
+        glm::vec3 position;
+        position.x = ParseFloat(p = SkipSpaces(p, end), end);
+        position.y = ParseFloat(p = SkipSpaces(p, end), end);
+        position.z = ParseFloat(p = SkipSpaces(p, end), end);
+        chunk.Vertices.push_back(position);
+    }
+    else if (isKeyword("vn"))
+    {
+        glm::vec3 normal;
+        normal.x = ParseFloat(p = SkipSpaces(p, end), end);
+        normal.y = ParseFloat(p = SkipSpaces(p, end), end);
+        normal.z = ParseFloat(p = SkipSpaces(p, end), end);
+        chunk.Normals.push_back(normal);
+    }
+    else if (isKeyword("vt"))
+    {
+        glm::vec2 texCoord;
+        texCoord.x = ParseFloat(p = SkipSpaces(p, end), end);
+        texCoord.y = ParseFloat(p = SkipSpaces(p, end), end);
+        chunk.TexCoords.push_back(texCoord);
+    }
+    else if (isKeyword("f"))
+    {
+        ParseFace(p, end, chunk);
+    }
+    else if (isKeyword("o") || isKeyword("g"))
+    {
+        chunk.ShapeChanges.push_back({chunk.Faces.size(), GetName(p, end)});
+    }
+    else if (isKeyword("usemtl"))
+    {
+        chunk.MaterialChanges.push_back({chunk.Faces.size(), GetName(p, end)});
+    }
+    else if (isKeyword("mtllib"))
+    {
+        chunk.MaterialLibraries.push_back(GetNames(p, end));
+    }
+}
+
+static void ParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+    const char* line = begin;
+    while (line < end)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (lineEnd == nullptr)
+        {
+            lineEnd = end;
+        }
+
+        // Comments are skipped along with everything else that is unknown
+        if (*line != '#')
+        {
+            ParseLine(line, lineEnd, chunk);
+        }
+
+        line = lineEnd + 1;
+    }
+}
+
+// Reads the newmtl and map_Kd records of a material library, which is small enough to not need any of the above.
+// Returns false if the file can't be opened.
+static bool ParseMaterialLibrary(const std::string& path, std::vector<ObjMaterial>& materials)
+{
+    std::ifstream file(path);
+    std::string   line;
+
+    if (!file)
+    {
+        return false;
+    }
+
+    while (std::getline(file, line))
+    {
+        const char* begin = line.data();
+        const char* end   = begin + line.size();
+        const char* p     = SkipSpaces(begin, end);
+
+        if (std::strncmp(p, "newmtl", 6) == 0 && p + 6 < end && IsSpace(p[6]))
+        {
+            ObjMaterial material;
+            material.Name = GetName(p + 6, end);
+            materials.push_back(material);
+        }
+        else if (std::strncmp(p, "map_Kd", 6) == 0 && p + 6 < end && IsSpace(p[6]) && !materials.empty())
+        {
+            // Options like -bm may come before the name, which is always last
+            std::string arguments = GetName(p + 6, end);
+            size_t      nameStart = arguments.find_last_of(" \t");
+
+            materials.back().DiffuseTextureName =
+                nameStart == std::string::npos ? arguments : arguments.substr(nameStart + 1);
+        }
+    }
+
+    return true;
+}
+
+bool ParseObjParallel(const std::string& path, ThreadPool& threadPool, ObjData& data, std::string& error)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        error = "Failed to open " + path;
+        return false;
+    }
+
+    const char* text = reinterpret_cast<const char*>(file.GetData());
+    size_t      size = file.GetSize();
+
+    // Cut the file into chunks of about equal size, each ending just after a line break
+    size_t numChunks = std::max<size_t>(
+        1, std::min<size_t>(size / OBJ_MIN_CHUNK_SIZE, threadPool.GetNumThreads() * OBJ_CHUNKS_PER_THREAD));
+
+    std::vector<size_t> chunkStarts(1, 0);
+    for (size_t i = 1; i < numChunks; i++)
+    {
+        size_t position = std::max(size * i / numChunks, chunkStarts.back());
+
+        const void* lineBreak = std::memchr(text + position, '\n', size - position);
+        if (lineBreak == nullptr)
+        {
+            break;
+        }
+        chunkStarts.push_back(static_cast<const char*>(lineBreak) - text + 1);
+    }
+    chunkStarts.push_back(size);
+    numChunks = chunkStarts.size() - 1;
+
+    std::vector<ObjChunk> chunks(numChunks);
+
+    threadPool.ParallelFor(static_cast<int>(numChunks), [&](int chunk) {
+        ParseChunk(text + chunkStarts[chunk], text + chunkStarts[chunk + 1], chunks[chunk]);
+    });
+
+    // Where the contents of every chunk go
+    struct ChunkOffsets
+    {
+        size_t Vertices;
+        size_t Normals;
+        size_t TexCoords;
+        size_t Faces;
+    };
+
+    std::vector<ChunkOffsets> offsets(numChunks);
+    ChunkOffsets              total = {};
+
+    for (size_t i = 0; i < numChunks; i++)
+    {
+        offsets[i] = total;
+        total.Vertices += chunks[i].Vertices.size();
+        total.Normals += chunks[i].Normals.size();
+        total.TexCoords += chunks[i].TexCoords.size();
+        total.Faces += chunks[i].Faces.size();
+    }
+
+    data.Vertices.resize(total.Vertices);
+    data.Normals.resize(total.Normals);
+    data.TexCoords.resize(total.TexCoords);
+    data.Faces.resize(total.Faces);
+    data.FaceMaterials.assign(total.Faces, -1);
+
+    // The first face of every chunk with an index that is out of range, if any
+    std::vector<size_t> invalidFaces(numChunks, total.Faces);
+
+    threadPool.ParallelFor(static_cast<int>(numChunks), [&](int i) {
+        ObjChunk&           chunk  = chunks[i];
+        const ChunkOffsets& offset = offsets[i];
+
+        // A relative index that counts back past the start of the file must not end up as -1, a left out attribute
+        auto fixUp = [](int& index, size_t offset) {
+            index += static_cast<int>(offset);
+            index = index >= 0 ? index : OBJ_INVALID_INDEX;
+        };
+
+        for (RelativeIndex& relative : chunk.RelativeIndices)
+        {
+            Index& corner = chunk.Faces[relative.Face][relative.Corner];
+
+            switch (relative.Attribute)
+            {
+            case 0:
+                fixUp(corner.VertexIndex, offset.Vertices);
+                break;
+            case 1:
+                fixUp(corner.NormalIndex, offset.Normals);
+                break;
+            default:
+                fixUp(corner.TexCoordIndex, offset.TexCoords);
+                break;
+            }
+        }
+
+        // Every corner needs a position, the other attributes may be left out
+        auto isInRange = [](int index, size_t count, bool isOptional) {
+            return (isOptional && index == -1) || (index >= 0 && static_cast<size_t>(index) < count);
+        };
+
+        for (size_t face = 0; face < chunk.Faces.size(); face++)
+        {
+            for (const Index& corner : chunk.Faces[face])
+            {
+                if (!isInRange(corner.VertexIndex, total.Vertices, false) ||
+                    !isInRange(corner.NormalIndex, total.Normals, true) ||
+                    !isInRange(corner.TexCoordIndex, total.TexCoords, true))
+                {
+                    invalidFaces[i] = std::min(invalidFaces[i], offset.Faces + face);
+                }
+            }
+        }
+
+        std::copy(chunk.Vertices.begin(), chunk.Vertices.end(), data.Vertices.begin() + offset.Vertices);
+        std::copy(chunk.Normals.begin(), chunk.Normals.end(), data.Normals.begin() + offset.Normals);
+        std::copy(chunk.TexCoords.begin(), chunk.TexCoords.end(), data.TexCoords.begin() + offset.TexCoords);
+        std::copy(chunk.Faces.begin(), chunk.Faces.end(), data.Faces.begin() + offset.Faces);
+
+        // Free the chunk as soon as it has been copied, to not hold on to two copies of a huge file
+        chunk.Vertices  = std::vector<glm::vec3>();
+        chunk.Normals   = std::vector<glm::vec3>();
+        chunk.TexCoords = std::vector<glm::vec2>();
+        chunk.Faces     = std::vector<Face>();
+    });
+
+    size_t invalidFace = *std::min_element(invalidFaces.begin(), invalidFaces.end());
+    if (invalidFace < total.Faces)
+    {
+        data  = ObjData();
+        error = "Triangle " + std::to_string(invalidFace + 1) + " of " + path +
+                " refers to a vertex, normal or texture coordinate that doesn't exist";
+        return false;
+    }
+
+    // The libraries have to be read before the materials can be looked up by name
+    std::string directory = std::filesystem::path(path).parent_path().string();
+
+    // Like tinyobjloader, an mtllib record with several names only reads the first one that can be opened. Which one
+    // that is depends on all of them, so all of them are reported.
+    for (const ObjChunk& chunk : chunks)
+    {
+        for (const std::vector<std::string>& libraries : chunk.MaterialLibraries)
+        {
+            for (const std::string& library : libraries)
+            {
+                if (ParseMaterialLibrary((std::filesystem::path(directory) / library).string(), data.Materials))
+                {
+                    break;
+                }
+            }
+            data.MaterialLibraries.insert(data.MaterialLibraries.end(), libraries.begin(), libraries.end());
+        }
+    }
+
+    std::unordered_map<std::string, int> materialIds;
+    for (size_t i = 0; i < data.Materials.size(); i++)
+    {
+        materialIds.emplace(data.Materials[i].Name, static_cast<int>(i));
+    }
+
+    // Shapes and materials carry over from one chunk into the next, so these are stitched together in order. A shape
+    // only gets added once it has faces, and an o or g record before the first face of a shape only renames it.
+    ObjShape shape;
+    int      material = -1;
+
+    for (size_t i = 0; i < numChunks; i++)
+    {
+        const ObjChunk& chunk        = chunks[i];
+        size_t          chunkEnd     = i + 1 < numChunks ? offsets[i + 1].Faces : total.Faces;
+        size_t          nextShape    = 0;
+        size_t          nextMaterial = 0;
+        size_t          face         = offsets[i].Faces;
+
+        while (face <= chunkEnd)
+        {
+            // Apply every change that comes before this face
+            while (nextShape < chunk.ShapeChanges.size() &&
+                   offsets[i].Faces + chunk.ShapeChanges[nextShape].Face == face)
+            {
+                shape.NumFaces = face - shape.FirstFace;
+                if (shape.NumFaces > 0)
+                {
+                    data.Shapes.push_back(shape);
+                }
+
+                shape.Name      = chunk.ShapeChanges[nextShape].Name;
+                shape.FirstFace = face;
+                nextShape++;
+            }
+
+            while (nextMaterial < chunk.MaterialChanges.size() &&
+                   offsets[i].Faces + chunk.MaterialChanges[nextMaterial].Face == face)
+            {
+                auto found = materialIds.find(chunk.MaterialChanges[nextMaterial].Name);
+                material   = found != materialIds.end() ? found->second : -1;
+                nextMaterial++;
+            }
+
+            if (face == chunkEnd)
+            {
+                break;
+            }
+
+            // Every face up to the next change gets the current material
+            size_t runEnd = chunkEnd;
+            if (nextShape < chunk.ShapeChanges.size())
+            {
+                runEnd = std::min(runEnd, offsets[i].Faces + chunk.ShapeChanges[nextShape].Face);
+            }
+            if (nextMaterial < chunk.MaterialChanges.size())
+            {
+                runEnd = std::min(runEnd, offsets[i].Faces + chunk.MaterialChanges[nextMaterial].Face);
+            }
+
+            std::fill(data.FaceMaterials.begin() + face, data.FaceMaterials.begin() + runEnd, material);
+            face = runEnd;
+        }
+    }
+
+    shape.NumFaces = total.Faces - shape.FirstFace;
+    if (shape.NumFaces > 0)
+    {
+        data.Shapes.push_back(shape);
+    }
+
+    return true;
+}
+
+std::vector<std::string> FindObjMaterialLibraries(const std::string& path)
+{
+    std::vector<std::string> libraries;
+
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return libraries;
+    }
+
+    const char* text = reinterpret_cast<const char*>(file.GetData());
+    const char* end  = text + file.GetSize();
+
+    for (const char* line = text; line < end;)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (lineEnd == nullptr)
+        {
+            lineEnd = end;
+        }
+
+        const char* p = SkipSpaces(line, lineEnd);
+        if (lineEnd - p > 6 && std::memcmp(p, "mtllib", 6) == 0 && IsSpace(p[6]))
+        {
+            std::vector<std::string> names = GetNames(p + 6, lineEnd);
+            libraries.insert(libraries.end(), names.begin(), names.end());
+        }
+
+        line = lineEnd + 1;
+    }
+
+    return libraries;
+}
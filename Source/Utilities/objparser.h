@@ -0,0 +1,55 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Utilities/model.h"
+#include "Utilities/threadpool.h"
+
+// An OBJ parser for files too large to parse on a single thread. The file is mapped into memory and cut into chunks
+// at line breaks, every chunk is parsed on its own thread, and the chunks are then stitched together in file order.
+//
+// It understands v, vn, vt and f records, o and g to split the faces into shapes, and mtllib and usemtl for the
+// diffuse textures of the materials. Faces with more than three corners are split into fans of triangles, and
+// attributes that a face corner doesn't have get an index of -1, the same as with tinyobjloader. Everything else in
+// the file is skipped.
+
+// A run of consecutive faces started by an o or g record
+struct ObjShape
+{
+    std::string Name;
+    size_t      FirstFace = 0;
+    size_t      NumFaces  = 0;
+};
+
+struct ObjMaterial
+{
+    std::string Name;
+    std::string DiffuseTextureName;
+};
+
+struct ObjData
+{
+    std::vector<glm::vec3> Vertices;
+    std::vector<glm::vec3> Normals;
+    std::vector<glm::vec2> TexCoords;
+    std::vector<Face>      Faces;
+    // The index into Materials of every face, -1 for faces without one
+    std::vector<int>         FaceMaterials;
+    std::vector<ObjShape>    Shapes;
+    std::vector<ObjMaterial> Materials;
+    // Every name on the mtllib records, in file order, relative to the directory of the file. These include the names
+    // that weren't read because an earlier one on the same record was.
+    std::vector<std::string> MaterialLibraries;
+};
+
+// Parses the file into data. Returns false and describes the problem in error if the file can't be read, or if a face
+// refers to a vertex, normal or texture coordinate that doesn't exist, or uses an index of 0.
+bool ParseObjParallel(const std::string& path, ThreadPool& threadPool, ObjData& data, std::string& error);
+
+// Only looks for the mtllib records, the same as ParseObjParallel finds them, for files parsed some other way. Returns
+// none if the file can't be read.
+std::vector<std::string> FindObjMaterialLibraries(const std::string& path);
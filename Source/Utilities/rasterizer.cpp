@@ -0,0 +1,673 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "glm/geometric.hpp"
+
+#include "Utilities/trianglesetup.h"
+
+float EdgeFunctionCW(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+{
+    return (c.x - a.x) * (b.y - a.y) - (c.y - a.y) * (b.x - a.x);
+}
+float EdgeFunctionCCW(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+{
+    return (a.x - b.x) * (c.y - a.y) - (a.y - b.y) * (c.x - a.x);
+}
+
+void DrawTriangle(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                  const PixelRect& clipRect)
+{
+    const glm::vec3* vertices = triangle.ScreenCoords;
+    const glm::vec2* uvs      = triangle.TexCoords;
+    const glm::vec3* normals  = triangle.Normals;
+
+    float area = EdgeFunctionCCW(vertices[0], vertices[1], vertices[2]);
+
+    // An area of 0 means that the triangle is degenerate, so does not need to be rendered
+    if (area == 0)
+    {
+        return;
+    }
+
+    // The inside of a triangle has all three edge functions <= 0 when it is wound counter clockwise, and all three
+    // >= 0 when it is wound clockwise. Flipping their signs for the latter lets both go through the same test.
+    float orientation = area < 0 ? 1.0f : -1.0f;
+
+    glm::vec2 bboxMin(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    glm::vec2 bboxMax(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+
+    // clamping the bounding box of the triangle to the clip rectangle (the whole screen, or a single tile)
+    glm::vec2 clampMin(clipRect.MinX, clipRect.MinY);
+    glm::vec2 clampMax(clipRect.MaxX, clipRect.MaxY);
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            bboxMin[j] = std::max(clampMin[j], std::min(bboxMin[j], vertices[i][j]));
+            bboxMax[j] = std::min(clampMax[j], std::max(bboxMax[j], vertices[i][j]));
+        }
+    }
+
+    // Pixels are sampled at integer coordinates, and the vertices can lie anywhere in between since they are no longer
+    // rounded to whole pixels
+    bboxMin = glm::vec2(std::ceil(bboxMin.x), std::ceil(bboxMin.y));
+    bboxMax = glm::vec2(std::floor(bboxMax.x), std::floor(bboxMax.y));
+
+    glm::vec3 point;
+    TGAColor  color;
+    glm::vec2 texCoord;
+    glm::vec3 normal;
+
+    // Loop throught all the pixels within the bounding box
+    for (point.x = bboxMin.x; point.x <= bboxMax.x; point.x++)
+    {
+        for (point.y = bboxMin.y; point.y <= bboxMax.y; point.y++)
+        {
+
+            // for each weigth, we take the edge function of the edge opposite it
+            float w0 = EdgeFunctionCCW(vertices[1], vertices[2], point);
+            float w1 = EdgeFunctionCCW(vertices[2], vertices[0], point);
+            float w2 = EdgeFunctionCCW(vertices[0], vertices[1], point);
+
+            // if point p is inside triangles defined by vertices v0, v1, v2
+            if (w0 * orientation <= 0 && w1 * orientation <= 0 && w2 * orientation <= 0)
+            {
+                // barycentric coordinates are the areas of the sub-triangles divided by the area of the main triangle
+                w0 /= area;
+                w1 /= area;
+                w2 /= area;
+
+                // interpolating using the barycentric coordinated to find the z value of the pixel
+                point.z = vertices[0].z * w0 + vertices[1].z * w1 + vertices[2].z * w2;
+
+                int pixelIndex = int(point.x + point.y * frameBuffer.Width);
+
+                // if the z value of the current pixel is more than the value store in the zBuffer, we draw the
+                // pixel and set the new value of the zBuffer at the current pixel
+                if (frameBuffer.ZBuffer[pixelIndex] < point.z)
+                {
+                    // Updating the zBuffer to hold the depth value of the current pixel
+                    frameBuffer.ZBuffer[pixelIndex] = point.z;
+
+                    // finding the fragment normal by interpolating the barycentric coordinates
+                    normal = glm::normalize(normals[0] * w0 + normals[1] * w1 + normals[2] * w2);
+
+                    // If the angle between normal and light direction is more than 90 (i.e. the light does not
+                    // illuinate the surface), then the dot product will be less than 0
+                    float lightIntensity = glm::dot(shading.LightDirection, normal);
+
+                    // If fragment is not illuminated, then don't draw it
+                    if (lightIntensity > 0)
+                    {
+                        // Finding the diffuse texture coordinates by interpolating the vertex texCoords using
+                        // barycentric coordinates
+                        texCoord = uvs[0] * w0 + uvs[1] * w1 + uvs[2] * w2;
+
+                        // Changing the brightness of the pixel based on the light intensity
+                        color = SampleTexture(*shading.DiffuseTexture, shading.Sampler, texCoord, 0.0f);
+                        color = color * lightIntensity;
+
+                        // Draw the pixel
+                        frameBuffer.Image->set(point.x, point.y, color);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void DrawTriangleIncremental(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                             const PixelRect& clipRect)
+{
+    TriangleSetup setup;
+    if (!SetupTriangle(triangle, clipRect, setup))
+    {
+        return;
+    }
+
+    const EdgeEquation& edge0 = setup.Edges[0];
+    const EdgeEquation& edge1 = setup.Edges[1];
+    const EdgeEquation& edge2 = setup.Edges[2];
+    const PixelRect&    bbox  = setup.BoundingBox;
+
+    float inverseArea = setup.InverseArea;
+    float z0          = setup.Z[0];
+    float z1          = setup.Z[1];
+    float z2          = setup.Z[2];
+
+    // Edge function values at the top of the current column
+    int64_t column0 = edge0.Evaluate(bbox.MinX, bbox.MinY);
+    int64_t column1 = edge1.Evaluate(bbox.MinX, bbox.MinY);
+    int64_t column2 = edge2.Evaluate(bbox.MinX, bbox.MinY);
+
+    for (int x = bbox.MinX; x <= bbox.MaxX; x++)
+    {
+        int64_t e0 = column0;
+        int64_t e1 = column1;
+        int64_t e2 = column2;
+
+        for (int y = bbox.MinY; y <= bbox.MaxY; y++)
+        {
+            if (e0 <= 0 && e1 <= 0 && e2 <= 0)
+            {
+                float z = z0 * e0 + z1 * e1 + z2 * e2;
+
+                float& depth = frameBuffer.ZBuffer[x + y * frameBuffer.Width];
+                if (depth < z)
+                {
+                    depth = z;
+
+                    TGAColor color;
+                    if (ShadeFragment(triangle, shading, e0 * inverseArea, e1 * inverseArea, e2 * inverseArea, color))
+                    {
+                        frameBuffer.Image->set(x, y, color);
+                    }
+                }
+            }
+
+            e0 += edge0.StepY;
+            e1 += edge1.StepY;
+            e2 += edge2.StepY;
+        }
+
+        column0 += edge0.StepX;
+        column1 += edge1.StepX;
+        column2 += edge2.StepX;
+    }
+}
+
+void DrawTriangleScanline(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                          const PixelRect& clipRect)
+{
+    TriangleSetup setup;
+    if (!SetupTriangle(triangle, clipRect, setup))
+    {
+        return;
+    }
+
+    const EdgeEquation& edge0 = setup.Edges[0];
+    const EdgeEquation& edge1 = setup.Edges[1];
+    const EdgeEquation& edge2 = setup.Edges[2];
+    const PixelRect&    bbox  = setup.BoundingBox;
+
+    float inverseArea = setup.InverseArea;
+    float z0          = setup.Z[0];
+    float z1          = setup.Z[1];
+    float z2          = setup.Z[2];
+
+    int    bytesPerPixel = frameBuffer.Image->get_bytespp();
+    size_t firstPixel    = bbox.MinX + static_cast<size_t>(bbox.MinY) * frameBuffer.Width;
+
+    // Pointers to the first pixel of the bounding box on the current row
+    float*        depthRow = frameBuffer.ZBuffer + firstPixel;
+    std::uint8_t* colorRow = frameBuffer.Image->buffer() + firstPixel * bytesPerPixel;
+
+    // Edge function values at the start of the current row
+    int64_t row0 = edge0.Evaluate(bbox.MinX, bbox.MinY);
+    int64_t row1 = edge1.Evaluate(bbox.MinX, bbox.MinY);
+    int64_t row2 = edge2.Evaluate(bbox.MinX, bbox.MinY);
+
+    for (int y = bbox.MinY; y <= bbox.MaxY; y++)
+    {
+        int64_t e0 = row0;
+        int64_t e1 = row1;
+        int64_t e2 = row2;
+
+        float*        depth = depthRow;
+        std::uint8_t* pixel = colorRow;
+
+        // Walking along the row only ever moves to the neighbouring float/pixel in memory
+        for (int x = bbox.MinX; x <= bbox.MaxX; x++)
+        {
+            if (e0 <= 0 && e1 <= 0 && e2 <= 0)
+            {
+                float z = z0 * e0 + z1 * e1 + z2 * e2;
+
+                if (*depth < z)
+                {
+                    *depth = z;
+
+                    TGAColor color;
+                    if (ShadeFragment(triangle, shading, e0 * inverseArea, e1 * inverseArea, e2 * inverseArea, color))
+                    {
+                        std::memcpy(pixel, color.bgra, bytesPerPixel);
+                    }
+                }
+            }
+
+            e0 += edge0.StepX;
+            e1 += edge1.StepX;
+            e2 += edge2.StepX;
+
+            depth++;
+            pixel += bytesPerPixel;
+        }
+
+        row0 += edge0.StepY;
+        row1 += edge1.StepY;
+        row2 += edge2.StepY;
+
+        depthRow += frameBuffer.Width;
+        colorRow += static_cast<size_t>(frameBuffer.Width) * bytesPerPixel;
+    }
+}
+
+// Rasterizes the pixels [x0, x1] x [y0, y1] of a block. When the block is known to be fully inside the triangle, the
+// coverage test is skipped and every pixel goes straight to the depth test. When the triangle is known to be in front
+// of everything in the block, the depth test is skipped as well. Every pixel that passes the depth test is handed to
+// writeFragment(pixelIndex, e0, e1, e2) along with its edge function values. Returns whether any depth was written.
+template <typename FragmentWriter>
+static inline bool DrawBlock(FrameBuffer& frameBuffer, const TriangleSetup& setup, int x0, int y0, int x1, int y1,
+                             bool isFullyInside, bool isInFront, FragmentWriter& writeFragment)
+{
+    bool hasWrittenDepth = false;
+
+    const EdgeEquation& edge0 = setup.Edges[0];
+    const EdgeEquation& edge1 = setup.Edges[1];
+    const EdgeEquation& edge2 = setup.Edges[2];
+
+    size_t rowPixel = x0 + static_cast<size_t>(y0) * frameBuffer.Width;
+
+    int64_t row0 = edge0.Evaluate(x0, y0);
+    int64_t row1 = edge1.Evaluate(x0, y0);
+    int64_t row2 = edge2.Evaluate(x0, y0);
+
+    for (int y = y0; y <= y1; y++)
+    {
+        int64_t e0 = row0;
+        int64_t e1 = row1;
+        int64_t e2 = row2;
+
+        size_t pixelIndex = rowPixel;
+
+        for (int x = x0; x <= x1; x++)
+        {
+            if (isFullyInside || (e0 <= 0 && e1 <= 0 && e2 <= 0))
+            {
+                float  z     = setup.Z[0] * e0 + setup.Z[1] * e1 + setup.Z[2] * e2;
+                float& depth = frameBuffer.ZBuffer[pixelIndex];
+
+                if (isInFront || depth < z)
+                {
+                    depth           = z;
+                    hasWrittenDepth = true;
+
+                    writeFragment(pixelIndex, e0, e1, e2);
+                }
+            }
+
+            e0 += edge0.StepX;
+            e1 += edge1.StepX;
+            e2 += edge2.StepX;
+
+            pixelIndex++;
+        }
+
+        row0 += edge0.StepY;
+        row1 += edge1.StepY;
+        row2 += edge2.StepY;
+
+        rowPixel += frameBuffer.Width;
+    }
+
+    return hasWrittenDepth;
+}
+
+// The block walk shared by the hierarchical backend and the visibility pass, see DrawTriangleHierarchical
+template <typename FragmentWriter>
+static void RasterizeHierarchical(const Triangle& triangle, FrameBuffer& frameBuffer, const TriangleSetup& setup,
+                                  FragmentWriter& writeFragment)
+{
+    const PixelRect& bbox = setup.BoundingBox;
+    HiZBuffer*       hiZ  = frameBuffer.HiZ;
+
+    // Every interpolated depth lies between the depths of the vertices, give or take the error of the fill rule
+    const glm::vec3* vertices      = triangle.ScreenCoords;
+    float            nearestDepth  = std::max({vertices[0].z, vertices[1].z, vertices[2].z}) + setup.DepthError;
+    float            farthestDepth = std::min({vertices[0].z, vertices[1].z, vertices[2].z}) - setup.DepthError;
+
+    // Blocks are aligned to the screen rather than to the bounding box, so that the same block always covers the
+    // same pixels no matter which triangle is being drawn
+    int firstBlockX = bbox.MinX - bbox.MinX % HIERARCHICAL_BLOCK_SIZE;
+    int firstBlockY = bbox.MinY - bbox.MinY % HIERARCHICAL_BLOCK_SIZE;
+
+    for (int blockY = firstBlockY; blockY <= bbox.MaxY; blockY += HIERARCHICAL_BLOCK_SIZE)
+    {
+        for (int blockX = firstBlockX; blockX <= bbox.MaxX; blockX += HIERARCHICAL_BLOCK_SIZE)
+        {
+            int  tileX     = blockX / HIZ_TILE_SIZE;
+            int  tileY     = blockY / HIZ_TILE_SIZE;
+            bool isInFront = false;
+
+            if (hiZ != nullptr)
+            {
+                // Everything already drawn in the block is at least as close as the triangle gets
+                if (nearestDepth <= hiZ->GetMinDepth(tileX, tileY))
+                {
+                    continue;
+                }
+
+                isInFront = farthestDepth > hiZ->GetMaxDepth(tileX, tileY);
+            }
+
+            // The part of the block inside the bounding box
+            int x0 = std::max(blockX, bbox.MinX);
+            int y0 = std::max(blockY, bbox.MinY);
+            int x1 = std::min(blockX + HIERARCHICAL_BLOCK_SIZE - 1, bbox.MaxX);
+            int y1 = std::min(blockY + HIERARCHICAL_BLOCK_SIZE - 1, bbox.MaxY);
+
+            bool isOutside     = false;
+            bool isFullyInside = true;
+
+            for (const EdgeEquation& edge : setup.Edges)
+            {
+                // An edge function is linear, so over the block it is smallest and largest at two of the corners.
+                // Which corners those are only depends on the signs of the steps.
+                int64_t cornerValue = edge.Evaluate(x0, y0);
+                int64_t spanX       = edge.StepX * (x1 - x0);
+                int64_t spanY       = edge.StepY * (y1 - y0);
+
+                int64_t minValue = cornerValue + std::min<int64_t>(spanX, 0) + std::min<int64_t>(spanY, 0);
+                int64_t maxValue = cornerValue + std::max<int64_t>(spanX, 0) + std::max<int64_t>(spanY, 0);
+
+                // Every pixel of the block is on the outer side of this edge
+                if (minValue > 0)
+                {
+                    isOutside = true;
+                    break;
+                }
+
+                // Some pixels of the block might be on the outer side of this edge
+                if (maxValue > 0)
+                {
+                    isFullyInside = false;
+                }
+            }
+
+            if (isOutside)
+            {
+                continue;
+            }
+
+            bool hasWrittenDepth =
+                DrawBlock(frameBuffer, setup, x0, y0, x1, y1, isFullyInside, isInFront, writeFragment);
+
+            if (hiZ != nullptr && hasWrittenDepth)
+            {
+                hiZ->UpdateTile(tileX, tileY, frameBuffer.ZBuffer);
+            }
+        }
+    }
+}
+
+void DrawTriangleHierarchical(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                              const PixelRect& clipRect)
+{
+    TriangleSetup setup;
+    if (!SetupTriangle(triangle, clipRect, setup))
+    {
+        return;
+    }
+
+    int           bytesPerPixel = frameBuffer.Image->get_bytespp();
+    std::uint8_t* colorBuffer   = frameBuffer.Image->buffer();
+
+    auto shadeFragment = [&](size_t pixelIndex, int64_t e0, int64_t e1, int64_t e2) {
+        TGAColor color;
+        if (ShadeFragment(triangle, shading, e0 * setup.InverseArea, e1 * setup.InverseArea, e2 * setup.InverseArea,
+                          color))
+        {
+            std::memcpy(colorBuffer + pixelIndex * bytesPerPixel, color.bgra, bytesPerPixel);
+        }
+    };
+
+    RasterizeHierarchical(triangle, frameBuffer, setup, shadeFragment);
+}
+
+void DrawTriangleVisibility(const Triangle& triangle, std::uint32_t triangleId, FrameBuffer& frameBuffer,
+                            VisibilityBuffer& visibility, const PixelRect& clipRect)
+{
+    TriangleSetup setup;
+    if (!SetupTriangle(triangle, clipRect, setup))
+    {
+        return;
+    }
+
+    auto writeVisibility = [&](size_t pixelIndex, int64_t, int64_t e1, int64_t e2) {
+        visibility.Write(pixelIndex, triangleId, e1 * setup.InverseArea, e2 * setup.InverseArea);
+    };
+
+    RasterizeHierarchical(triangle, frameBuffer, setup, writeVisibility);
+}
+
+TileRasterizer::TileRasterizer(int width, int height, int tileSize)
+    : m_Backend(RasterizerBackend::Reference), m_CullMode(CullMode::Clockwise), m_Width(width), m_Height(height),
+      m_TileSize(tileSize), m_NumTilesX((width + tileSize - 1) / tileSize),
+      m_NumTilesY((height + tileSize - 1) / tileSize), m_NumBatches(0), m_Bins()
+{
+    assert(tileSize % HIZ_TILE_SIZE == 0);
+}
+
+PixelRect TileRasterizer::GetTileRect(int tileIndex) const
+{
+    int tileX = tileIndex % m_NumTilesX;
+    int tileY = tileIndex / m_NumTilesX;
+
+    PixelRect rect;
+    rect.MinX = tileX * m_TileSize;
+    rect.MinY = tileY * m_TileSize;
+    rect.MaxX = std::min(rect.MinX + m_TileSize, m_Width) - 1;
+    rect.MaxY = std::min(rect.MinY + m_TileSize, m_Height) - 1;
+
+    return rect;
+}
+
+void TileRasterizer::BinTriangles(const std::vector<Triangle>& triangles, ThreadPool& threadPool)
+{
+    int numTriangles = static_cast<int>(triangles.size());
+    int numTiles     = GetNumTiles();
+
+    m_NumBatches = std::max(1, std::min(numTriangles, static_cast<int>(threadPool.GetNumThreads())));
+
+    // Keep the bins around between frames so that their memory gets reused
+    m_Bins.resize(static_cast<size_t>(m_NumBatches) * numTiles);
+    for (std::vector<int>& bin : m_Bins)
+    {
+        bin.clear();
+    }
+
+    m_BatchVisibleTriangles.resize(m_NumBatches);
+    std::vector<CullStats> batchStats(m_NumBatches);
+
+    int batchSize = (numTriangles + m_NumBatches - 1) / m_NumBatches;
+
+    threadPool.ParallelFor(m_NumBatches, [&](int batch) {
+        int first = std::min(batch * batchSize, numTriangles);
+        int last  = std::min(first + batchSize, numTriangles);
+
+        std::vector<int>* batchBins = &m_Bins[static_cast<size_t>(batch) * numTiles];
+
+        // Drop the triangles that can't be seen before spending any time on their bounding boxes
+        std::vector<int>& visibleTriangles = m_BatchVisibleTriangles[batch];
+        visibleTriangles.clear();
+        CullTriangles(triangles, first, last - first, m_CullMode, visibleTriangles, batchStats[batch]);
+
+        for (int i : visibleTriangles)
+        {
+            const glm::vec3* vertices = triangles[i].ScreenCoords;
+
+            float minX = std::min({vertices[0].x, vertices[1].x, vertices[2].x});
+            float minY = std::min({vertices[0].y, vertices[1].y, vertices[2].y});
+            float maxX = std::max({vertices[0].x, vertices[1].x, vertices[2].x});
+            float maxY = std::max({vertices[0].y, vertices[1].y, vertices[2].y});
+
+            // Triangles entirely off screen don't go into any bin
+            if (maxX < 0 || maxY < 0 || minX > m_Width - 1 || minY > m_Height - 1)
+            {
+                continue;
+            }
+
+            int firstTileX = std::max(0, static_cast<int>(minX)) / m_TileSize;
+            int firstTileY = std::max(0, static_cast<int>(minY)) / m_TileSize;
+            int lastTileX  = std::min(m_Width - 1, static_cast<int>(maxX)) / m_TileSize;
+            int lastTileY  = std::min(m_Height - 1, static_cast<int>(maxY)) / m_TileSize;
+
+            for (int tileY = firstTileY; tileY <= lastTileY; tileY++)
+            {
+                for (int tileX = firstTileX; tileX <= lastTileX; tileX++)
+                {
+                    batchBins[tileX + tileY * m_NumTilesX].push_back(i);
+                }
+            }
+        }
+    });
+
+    m_CullStats = CullStats();
+    for (const CullStats& stats : batchStats)
+    {
+        m_CullStats += stats;
+    }
+}
+
+// Whether the part of the triangle inside tileRect is entirely behind what has been drawn so far
+static bool IsHidden(const Triangle& triangle, const HiZBuffer& hiZ, const PixelRect& tileRect)
+{
+    const glm::vec3* vertices = triangle.ScreenCoords;
+
+    float left   = std::min({vertices[0].x, vertices[1].x, vertices[2].x});
+    float bottom = std::min({vertices[0].y, vertices[1].y, vertices[2].y});
+    float right  = std::max({vertices[0].x, vertices[1].x, vertices[2].x});
+    float top    = std::max({vertices[0].y, vertices[1].y, vertices[2].y});
+
+    // Rounded outwards, so that it contains every pixel any of the backends could draw
+    int minX = std::max(tileRect.MinX, static_cast<int>(std::floor(left)));
+    int minY = std::max(tileRect.MinY, static_cast<int>(std::floor(bottom)));
+    int maxX = std::min(tileRect.MaxX, static_cast<int>(std::ceil(right)));
+    int maxY = std::min(tileRect.MaxY, static_cast<int>(std::ceil(top)));
+
+    if (minX > maxX || minY > maxY)
+    {
+        return true;
+    }
+
+    // The backends can interpolate a depth slightly nearer than that of the nearest vertex, see GetDepthError
+    glm::ivec2 points[3];
+    for (int i = 0; i < 3; i++)
+    {
+        points[i] = glm::ivec2(SnapToSubpixel(vertices[i].x), SnapToSubpixel(vertices[i].y));
+    }
+    float depthError   = GetDepthError(vertices, GetSignedArea(points[0], points[1], points[2]));
+    float nearestDepth = std::max({vertices[0].z, vertices[1].z, vertices[2].z}) + depthError;
+
+    return hiZ.IsOccluded(minX, minY, maxX, maxY, nearestDepth);
+}
+
+void TileRasterizer::Render(const std::vector<Triangle>& triangles, const ShadingState& shading,
+                            FrameBuffer& frameBuffer, ThreadPool& threadPool)
+{
+    std::vector<ShadingBatch> batches = {{0, static_cast<int>(triangles.size()), &shading}};
+    Render(triangles, batches, frameBuffer, threadPool);
+}
+
+void TileRasterizer::Render(const std::vector<Triangle>& triangles, const std::vector<ShadingBatch>& batches,
+                            FrameBuffer& frameBuffer, ThreadPool& threadPool)
+{
+    BinTriangles(triangles, threadPool);
+
+    int numTiles = GetNumTiles();
+
+    threadPool.ParallelFor(numTiles, [&](int tile) {
+        PixelRect tileRect = GetTileRect(tile);
+
+        // The triangles of a tile come in increasing order, so their shading batch only ever moves forward
+        size_t shadingBatch = 0;
+
+        // Going through the batches in order draws the triangles of every tile in the order they were submitted, so
+        // the result is the same as drawing them one after the other on a single thread
+        for (int batch = 0; batch < m_NumBatches; batch++)
+        {
+            for (int triangleIndex : m_Bins[static_cast<size_t>(batch) * numTiles + tile])
+            {
+                if (frameBuffer.HiZ != nullptr && IsHidden(triangles[triangleIndex], *frameBuffer.HiZ, tileRect))
+                {
+                    continue;
+                }
+
+                while (triangleIndex >= batches[shadingBatch].FirstTriangle + batches[shadingBatch].NumTriangles)
+                {
+                    shadingBatch++;
+                }
+                const ShadingState& shading = *batches[shadingBatch].Shading;
+
+                switch (m_Backend)
+                {
+                case RasterizerBackend::Reference:
+                    DrawTriangle(triangles[triangleIndex], shading, frameBuffer, tileRect);
+                    break;
+                case RasterizerBackend::Incremental:
+                    DrawTriangleIncremental(triangles[triangleIndex], shading, frameBuffer, tileRect);
+                    break;
+                case RasterizerBackend::Scanline:
+                    DrawTriangleScanline(triangles[triangleIndex], shading, frameBuffer, tileRect);
+                    break;
+                case RasterizerBackend::SIMD:
+                    DrawTriangleSIMD(triangles[triangleIndex], shading, frameBuffer, tileRect);
+                    break;
+                case RasterizerBackend::Hierarchical:
+                    DrawTriangleHierarchical(triangles[triangleIndex], shading, frameBuffer, tileRect);
+                    break;
+                }
+            }
+        }
+
+        // The other backends only write to the zBuffer, so bring the Hi-Z tiles back in sync with it
+        if (frameBuffer.HiZ != nullptr && m_Backend != RasterizerBackend::Hierarchical)
+        {
+            frameBuffer.HiZ->UpdateRect(tileRect.MinX, tileRect.MinY, tileRect.MaxX, tileRect.MaxY,
+                                        frameBuffer.ZBuffer);
+        }
+    });
+}
+
+void TileRasterizer::RenderDeferred(const std::vector<Triangle>& triangles, const ShadingState& shading,
+                                    FrameBuffer& frameBuffer, VisibilityBuffer& visibility, ThreadPool& threadPool)
+{
+    std::vector<ShadingBatch> batches = {{0, static_cast<int>(triangles.size()), &shading}};
+    RenderDeferred(triangles, batches, frameBuffer, visibility, threadPool);
+}
+
+void TileRasterizer::RenderDeferred(const std::vector<Triangle>& triangles, const std::vector<ShadingBatch>& batches,
+                                    FrameBuffer& frameBuffer, VisibilityBuffer& visibility, ThreadPool& threadPool)
+{
+    BinTriangles(triangles, threadPool);
+
+    int numTiles = GetNumTiles();
+
+    // Both passes run back to back on the same tile, while its part of the buffers is still in the cache
+    threadPool.ParallelFor(numTiles, [&](int tile) {
+        PixelRect tileRect = GetTileRect(tile);
+
+        for (int batch = 0; batch < m_NumBatches; batch++)
+        {
+            for (int triangleIndex : m_Bins[static_cast<size_t>(batch) * numTiles + tile])
+            {
+                if (frameBuffer.HiZ != nullptr && IsHidden(triangles[triangleIndex], *frameBuffer.HiZ, tileRect))
+                {
+                    continue;
+                }
+
+                DrawTriangleVisibility(triangles[triangleIndex], static_cast<std::uint32_t>(triangleIndex),
+                                       frameBuffer, visibility, tileRect);
+            }
+        }
+
+        visibility.ResolveColor(triangles, batches, *frameBuffer.Image, tileRect);
+    });
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "Utilities/cpufeatures.h"
+#include "Utilities/culling.h"
+#include "Utilities/hizbuffer.h"
+#include "Utilities/model.h"
+#include "Utilities/sampler.h"
+#include "Utilities/texture.h"
+#include "Utilities/tgaimage.h"
+#include "Utilities/threadpool.h"
+#include "Utilities/visibilitybuffer.h"
+
+// A triangle that has already been transformed to screen space, along with the attributes to interpolate over it
+struct Triangle
+{
+    glm::vec3 ScreenCoords[3];
+    glm::vec2 TexCoords[3];
+    glm::vec3 Normals[3];
+};
+
+// The buffers a triangle is rasterized into. The zBuffer holds Width * Height floats, one per pixel of the image.
+struct FrameBuffer
+{
+    TGAImage* Image;
+    float*    ZBuffer;
+    int       Width;
+    int       Height;
+
+    // Optional. When set, it has to be cleared along with the zBuffer, and is then used to skip triangles and blocks
+    // hidden behind what has already been drawn.
+    HiZBuffer* HiZ = nullptr;
+};
+
+struct ShadingState
+{
+    const Texture* DiffuseTexture;
+    glm::vec3      LightDirection;
+    SamplerState   Sampler = {};
+};
+
+// A run of consecutive triangles that are all shaded the same way, like the triangles of one material. The batches of
+// a render have to cover all of its triangles, in order and without gaps.
+struct ShadingBatch
+{
+    int                 FirstTriangle;
+    int                 NumTriangles;
+    const ShadingState* Shading;
+};
+
+// The different ways a triangle can be turned into pixels. All but Reference share the same fixed point setup and
+// produce the same image, differing only in how fast they get there.
+enum class RasterizerBackend
+{
+    // Evaluates the three edge functions from scratch for every pixel, in floating point and without the top-left fill
+    // rule. Pixels exactly on an edge shared by two triangles can be drawn by both or by neither, so the image may
+    // differ from the other backends along those edges.
+    Reference,
+    // Sets up the edge functions once per triangle in integer arithmetic and steps them with additions
+    Incremental,
+    // Incremental, but walking the pixels row by row so that the buffers are accessed in memory order
+    Scanline,
+    // Scanline, testing coverage and depth for 4, 8 or 16 pixels at once depending on what the CPU supports
+    SIMD,
+    // Classifies 8x8 blocks against the edges first, skipping blocks outside the triangle and filling blocks inside it
+    // without testing every pixel
+    Hierarchical
+};
+
+// The size of the square blocks the hierarchical backend classifies, in pixels. It matches the Hi-Z tiles, so that
+// every block can be tested against and update exactly one tile.
+const int HIERARCHICAL_BLOCK_SIZE = HIZ_TILE_SIZE;
+
+// A rectangle of pixels. Both the min and the max bounds are inclusive.
+struct PixelRect
+{
+    int MinX;
+    int MinY;
+    int MaxX;
+    int MaxY;
+};
+
+float EdgeFunctionCW(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c);
+float EdgeFunctionCCW(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c);
+
+// Rasterizes and shades a single triangle, only touching the pixels inside clipRect
+void DrawTriangle(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                  const PixelRect& clipRect);
+
+// Same as DrawTriangle, but instead of evaluating the edge functions at every pixel, they are set up once from the
+// screen coordinates snapped to 28.4 fixed point and then advanced by a constant per pixel step. Since all of this is
+// exact integer arithmetic, pixels on an edge shared by two triangles get the same edge value in both, and the
+// top-left fill rule then gives each of those pixels to exactly one of them: no gaps, and nothing drawn twice.
+//
+// All the backends below share this setup, so they all cover exactly the same pixels.
+void DrawTriangleIncremental(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                             const PixelRect& clipRect);
+
+// Same as DrawTriangleIncremental, but with y in the outer loop and x in the inner one. The zBuffer and the image are
+// both stored row by row, so this walks them with pointers that only ever move to the next pixel, instead of jumping
+// a whole row of memory for every pixel.
+void DrawTriangleScanline(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                          const PixelRect& clipRect);
+
+// Same traversal as DrawTriangleScanline, but evaluating the edge functions, interpolating the depth and doing the
+// depth test for a whole group of pixels of a row at once with SSE2, AVX2 or AVX-512. Shading is still done per pixel,
+// only for the pixels that pass the depth test.
+void DrawTriangleSIMD(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                      const PixelRect& clipRect);
+
+// Splits the bounding box into HIERARCHICAL_BLOCK_SIZE blocks and tests the corners of each block against the edges
+// before looking at its pixels. Blocks entirely outside any edge are skipped, blocks entirely inside all edges are
+// drawn without any coverage test, and only the blocks an edge passes through are tested pixel by pixel. For large
+// triangles, that is only a thin band of blocks along the edges.
+//
+// With a Hi-Z buffer, blocks entirely behind what is already in the zBuffer are skipped as well, and blocks entirely in
+// front of it skip the per-pixel depth test. This is the only backend that keeps the Hi-Z buffer up to date as it
+// draws, the tile rasterizer refreshes it after each tile for the others.
+void DrawTriangleHierarchical(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                              const PixelRect& clipRect);
+
+// Rasterizes the triangle like DrawTriangleHierarchical, but instead of shading the pixels that pass the depth test,
+// records the triangle id and barycentric coordinates in the visibility buffer.
+void DrawTriangleVisibility(const Triangle& triangle, std::uint32_t triangleId, FrameBuffer& frameBuffer,
+                            VisibilityBuffer& visibility, const PixelRect& clipRect);
+
+// Picks the instruction set DrawTriangleSIMD uses. Defaults to the widest one the CPU supports, and requests for
+// anything wider than that are clamped to it. Not thread safe, only change this between renders.
+void      SetSimdLevel(SimdLevel level);
+SimdLevel GetSimdLevel();
+
+// Sorts triangles into square screen tiles and then rasterizes the tiles in parallel. Every tile only ever writes to
+// its own pixels of the zBuffer and image, so the workers never have to lock anything. The tile size has to be a
+// multiple of HIZ_TILE_SIZE, so that Hi-Z tiles never straddle two of them.
+//
+// Before binning, a culling stage drops back facing and degenerate triangles, so they never get to the backends. When
+// the frame buffer has a Hi-Z buffer, triangles that are hidden over their whole part of a tile are skipped as well.
+class TileRasterizer
+{
+
+  public:
+    TileRasterizer(int width, int height, int tileSize = 64);
+
+    void Render(const std::vector<Triangle>& triangles, const ShadingState& shading, FrameBuffer& frameBuffer,
+                ThreadPool& threadPool);
+
+    // Same, with every batch of triangles shaded with its own state, all in a single pass over the tiles
+    void Render(const std::vector<Triangle>& triangles, const std::vector<ShadingBatch>& batches,
+                FrameBuffer& frameBuffer, ThreadPool& threadPool);
+
+    // Renders in two passes: a depth-only pass filling the visibility buffer, followed by a single shading pass over
+    // the visible pixels. Costs an extra buffer, but no pixel is ever shaded only to be drawn over later. Always
+    // rasterizes with the hierarchical backend. The visibility buffer has to be cleared along with the zBuffer, and
+    // can be resolved again afterwards with another shading state.
+    void RenderDeferred(const std::vector<Triangle>& triangles, const ShadingState& shading, FrameBuffer& frameBuffer,
+                        VisibilityBuffer& visibility, ThreadPool& threadPool);
+
+    void RenderDeferred(const std::vector<Triangle>& triangles, const std::vector<ShadingBatch>& batches,
+                        FrameBuffer& frameBuffer, VisibilityBuffer& visibility, ThreadPool& threadPool);
+
+    inline int  GetNumTiles() const { return m_NumTilesX * m_NumTilesY; }
+    inline void SetBackend(RasterizerBackend backend) { m_Backend = backend; }
+
+    // Back faces are culled by default, which is what the backends used to do on their own
+    inline void SetCullMode(CullMode cullMode) { m_CullMode = cullMode; }
+
+    // What the culling stage did during the last render
+    inline const CullStats& GetCullStats() const { return m_CullStats; }
+
+  private:
+    void      BinTriangles(const std::vector<Triangle>& triangles, ThreadPool& threadPool);
+    PixelRect GetTileRect(int tileIndex) const;
+
+    RasterizerBackend m_Backend;
+    CullMode          m_CullMode;
+    CullStats         m_CullStats;
+
+    int m_Width;
+    int m_Height;
+    int m_TileSize;
+    int m_NumTilesX;
+    int m_NumTilesY;
+
+    // Triangles are binned in contiguous batches, each batch having its own set of bins so that binning can run in
+    // parallel. m_Bins[batch * numTiles + tile] holds the indices of the triangles of that batch touching that tile.
+    int                           m_NumBatches;
+    std::vector<std::vector<int>> m_Bins;
+    // The triangles of each batch that made it through culling
+    std::vector<std::vector<int>> m_BatchVisibleTriangles;
+};
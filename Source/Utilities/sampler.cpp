@@ -0,0 +1,447 @@
+#include "sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Utilities/cpufeatures.h"
+
+#if RENDERER_X86
+#include <immintrin.h>
+#endif
+
+// The two mip levels trilinear filtering reads for a level of detail, and how much of the second one goes into the
+// result. There is no second level when the blend is 0.
+struct LevelBlend
+{
+    int   Level;
+    float Blend;
+};
+
+static LevelBlend SelectLevels(const Texture& texture, const SamplerState& sampler, float lod)
+{
+    // Nearest and bilinear filtering only ever read the full resolution level, and so does trilinear filtering of a
+    // texture without a mip chain
+    if (sampler.Filter != TextureFilter::Trilinear)
+    {
+        return {0, 0.0f};
+    }
+
+    int   maxLevel = static_cast<int>(texture.MipLevels.size());
+    float clamped  = std::min(std::max(lod, 0.0f), static_cast<float>(maxLevel));
+    int   level    = static_cast<int>(clamped);
+    float blend    = level < maxLevel ? clamped - level : 0.0f;
+
+    return {level, blend};
+}
+
+static inline TGAColor ToColor(const float color[3])
+{
+    return TGAColor(static_cast<std::uint8_t>(color[0] + 0.5f), static_cast<std::uint8_t>(color[1] + 0.5f),
+                    static_cast<std::uint8_t>(color[2] + 0.5f));
+}
+
+// Maps a texture coordinate into [0, 1] the way the address mode says
+static inline float ApplyAddressMode(float coordinate, TextureAddressMode addressMode)
+{
+    switch (addressMode)
+    {
+    case TextureAddressMode::Clamp:
+        return std::min(std::max(coordinate, 0.0f), 1.0f);
+    case TextureAddressMode::Mirror:
+    {
+        // Every other repeat runs backwards
+        float repeat = coordinate - 2.0f * std::floor(coordinate * 0.5f);
+        return repeat > 1.0f ? 2.0f - repeat : repeat;
+    }
+    case TextureAddressMode::Wrap:
+    default:
+        return coordinate - std::floor(coordinate);
+    }
+}
+
+// The four texels around a coordinate in [0, 1] can be one past either edge of the level. Wrapping brings them back
+// in on the opposite edge, clamping and mirroring both take the texel on the edge again.
+static inline int AddressTexel(int texel, int size, TextureAddressMode addressMode)
+{
+    if (texel < 0)
+    {
+        return addressMode == TextureAddressMode::Wrap ? size - 1 : 0;
+    }
+    if (texel >= size)
+    {
+        return addressMode == TextureAddressMode::Wrap ? 0 : size - 1;
+    }
+    return texel;
+}
+
+// The number of decoded tiles of compressed textures each thread keeps around, about 100 KB worth. The texels read for
+// a pixel are mostly in the same tiles as the ones of the pixel before, and of the pixel below it, which was a whole
+// row of pixels earlier. This is enough to hold a row of tiles across a 4096 texels wide texture, so that those are
+// only decoded once rather than again for every row of pixels.
+const unsigned int DECODED_BLOCK_CACHE_SIZE = 1024;
+
+// A compressed tile along with its decoded texels. The compressed bytes are kept as well and compared on every lookup,
+// so that a texture that goes away can't leave stale texels behind for another one that takes its place in memory.
+//
+// Left without member initializers, so that a thread's cache starts out zeroed without being constructed. Otherwise
+// every access would first check whether the thread had constructed it yet.
+struct DecodedBlock
+{
+    const unsigned char* Block;
+    int                  NumComponents;
+    std::uint64_t        Compressed[2];
+    unsigned char        Texels[TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE * 4];
+};
+
+static const unsigned char* FetchCompressedTexel(const TextureLevel& level, int numComponents, int x, int y)
+{
+    // Per thread, so that the rasterizer threads each have their own without any locking
+    static thread_local DecodedBlock cache[DECODED_BLOCK_CACHE_SIZE];
+
+    const unsigned char* block = level.Data + GetBlockOffset(level.Width, numComponents, x, y);
+
+    // Tiles a whole row of tiles apart are usually read together, so the slot comes from hashing the address rather
+    // than from its bottom bits, which would put them all in the same one for power of two sized textures. Blocks are
+    // at least 8 bytes apart.
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block) >> 3;
+    DecodedBlock&  decoded =
+        cache[static_cast<std::uint32_t>(address * 2654435761u) >> 16 & (DECODED_BLOCK_CACHE_SIZE - 1)];
+
+    // Compared 8 bytes at a time, the second half only being there for blocks with alpha
+    std::uint64_t compressed[2] = {};
+    std::memcpy(compressed, block, GetCompressedBlockSize(numComponents));
+
+    if (decoded.Block != block || decoded.NumComponents != numComponents || decoded.Compressed[0] != compressed[0] ||
+        decoded.Compressed[1] != compressed[1])
+    {
+        DecodeTextureBlock(block, numComponents, decoded.Texels);
+        decoded.Block         = block;
+        decoded.NumComponents = numComponents;
+        decoded.Compressed[0] = compressed[0];
+        decoded.Compressed[1] = compressed[1];
+    }
+
+    unsigned int texel = (static_cast<unsigned int>(y) % TEXTURE_TILE_SIZE) * TEXTURE_TILE_SIZE +
+                         static_cast<unsigned int>(x) % TEXTURE_TILE_SIZE;
+    return decoded.Texels + texel * numComponents;
+}
+
+// The components of the texel at (x, y). Those of compressed textures are decoded first, and only stay where the
+// pointer points until the next texel is fetched.
+static inline const unsigned char* FetchTexel(const TextureLevel& level, int numComponents, int x, int y)
+{
+    if (level.Layout == TextureLayout::Compressed)
+    {
+        return FetchCompressedTexel(level, numComponents, x, y);
+    }
+
+    return level.Data + GetTexelIndex(level.Layout, level.Width, x, y) * numComponents;
+}
+
+// Reads the texel the addressed coordinates fall in, into color
+static void FilterNearest(const TextureLevel& level, int numComponents, float u, float v, float color[3])
+{
+    // The coordinates can be exactly 1, which would be past the last texel
+    int x = std::min(static_cast<int>(u * level.Width), level.Width - 1);
+    int y = std::min(static_cast<int>(v * level.Height), level.Height - 1);
+
+    const unsigned char* texel = FetchTexel(level, numComponents, x, y);
+
+    for (int component = 0; component < 3; component++)
+    {
+        color[component] = texel[std::min(component, numComponents - 1)];
+    }
+}
+
+// Bilinearly filters the texels around the addressed coordinates, into color
+static void FilterBilinear(const TextureLevel& level, int numComponents, TextureAddressMode addressMode, float u,
+                           float v, float color[3])
+{
+    // Texel centers are at half coordinates
+    float x = u * level.Width - 0.5f;
+    float y = v * level.Height - 0.5f;
+
+    float left   = std::floor(x);
+    float bottom = std::floor(y);
+    float fx     = x - left;
+    float fy     = y - bottom;
+
+    int x0 = AddressTexel(static_cast<int>(left), level.Width, addressMode);
+    int y0 = AddressTexel(static_cast<int>(bottom), level.Height, addressMode);
+    int x1 = AddressTexel(static_cast<int>(left) + 1, level.Width, addressMode);
+    int y1 = AddressTexel(static_cast<int>(bottom) + 1, level.Height, addressMode);
+
+    // Read straight away, since a fetched texel doesn't stay put for compressed textures
+    const int columns[4] = {x0, x1, x0, x1};
+    const int rows[4]    = {y0, y0, y1, y1};
+
+    float texels[4][3];
+    for (int corner = 0; corner < 4; corner++)
+    {
+        const unsigned char* texel = FetchTexel(level, numComponents, columns[corner], rows[corner]);
+
+        for (int component = 0; component < 3; component++)
+        {
+            texels[corner][component] = texel[std::min(component, numComponents - 1)];
+        }
+    }
+
+    float weights[4] = {(1.0f - fx) * (1.0f - fy), fx * (1.0f - fy), (1.0f - fx) * fy, fx * fy};
+
+    for (int component = 0; component < 3; component++)
+    {
+        color[component] = texels[0][component] * weights[0] + texels[1][component] * weights[1] +
+                           texels[2][component] * weights[2] + texels[3][component] * weights[3];
+    }
+}
+
+TGAColor SampleTexture(const Texture& texture, const SamplerState& sampler, const glm::vec2& uv, float lod)
+{
+    float u = ApplyAddressMode(uv.x, sampler.AddressMode);
+    float v = ApplyAddressMode(uv.y, sampler.AddressMode);
+
+    float color[3];
+
+    if (sampler.Filter == TextureFilter::Nearest)
+    {
+        FilterNearest(GetTextureLevel(texture, 0), texture.NumComponents, u, v, color);
+        return ToColor(color);
+    }
+
+    LevelBlend levels = SelectLevels(texture, sampler, lod);
+    FilterBilinear(GetTextureLevel(texture, levels.Level), texture.NumComponents, sampler.AddressMode, u, v, color);
+
+    if (levels.Blend > 0.0f)
+    {
+        float nextColor[3];
+        FilterBilinear(GetTextureLevel(texture, levels.Level + 1), texture.NumComponents, sampler.AddressMode, u, v,
+                       nextColor);
+
+        for (int component = 0; component < 3; component++)
+        {
+            color[component] += (nextColor[component] - color[component]) * levels.Blend;
+        }
+    }
+
+    return ToColor(color);
+}
+
+#if RENDERER_X86
+
+// The same steps as above for four coordinates at once, one per lane, with the operations done in the same order so
+// that the results match exactly. SSE2 is part of x86-64, so this needs no check.
+
+// SSE2 has no floor, so the value is truncated towards zero and then moved down for negative fractions
+static inline __m128 FloorSSE(__m128 x)
+{
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.0f)));
+}
+
+// a where mask is set, b everywhere else
+static inline __m128i SelectSSE(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128 ApplyAddressModeSSE(__m128 coordinate, TextureAddressMode addressMode)
+{
+    __m128 one = _mm_set1_ps(1.0f);
+
+    switch (addressMode)
+    {
+    case TextureAddressMode::Clamp:
+        return _mm_min_ps(_mm_max_ps(coordinate, _mm_setzero_ps()), one);
+    case TextureAddressMode::Mirror:
+    {
+        __m128 repeat =
+            _mm_sub_ps(coordinate, _mm_mul_ps(_mm_set1_ps(2.0f), FloorSSE(_mm_mul_ps(coordinate, _mm_set1_ps(0.5f)))));
+        __m128 backwards = _mm_cmpgt_ps(repeat, one);
+        return _mm_or_ps(_mm_and_ps(backwards, _mm_sub_ps(_mm_set1_ps(2.0f), repeat)),
+                         _mm_andnot_ps(backwards, repeat));
+    }
+    case TextureAddressMode::Wrap:
+    default:
+        return _mm_sub_ps(coordinate, FloorSSE(coordinate));
+    }
+}
+
+static inline __m128i AddressTexelSSE(__m128i texel, int size, TextureAddressMode addressMode)
+{
+    __m128i first = _mm_setzero_si128();
+    __m128i last  = _mm_set1_epi32(size - 1);
+
+    __m128i beforeFirst = _mm_cmplt_epi32(texel, first);
+    __m128i afterLast   = _mm_cmpgt_epi32(texel, last);
+
+    bool wrap = addressMode == TextureAddressMode::Wrap;
+    texel     = SelectSSE(beforeFirst, wrap ? last : first, texel);
+    return SelectSSE(afterLast, wrap ? first : last, texel);
+}
+
+static void FilterNearestSSE(const TextureLevel& level, int numComponents, __m128 u, __m128 v, __m128 color[3])
+{
+    // Both are at least 0, where truncating is the same as flooring
+    __m128i x = _mm_cvttps_epi32(_mm_mul_ps(u, _mm_set1_ps(static_cast<float>(level.Width))));
+    __m128i y = _mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(static_cast<float>(level.Height))));
+
+    __m128i lastX = _mm_set1_epi32(level.Width - 1);
+    __m128i lastY = _mm_set1_epi32(level.Height - 1);
+    x             = SelectSSE(_mm_cmpgt_epi32(x, lastX), lastX, x);
+    y             = SelectSSE(_mm_cmpgt_epi32(y, lastY), lastY, y);
+
+    alignas(16) std::int32_t columns[4];
+    alignas(16) std::int32_t rows[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(columns), x);
+    _mm_store_si128(reinterpret_cast<__m128i*>(rows), y);
+
+    // SSE2 has no gather, so the texels are read one lane at a time
+    alignas(16) float texels[3][4];
+    for (int lane = 0; lane < 4; lane++)
+    {
+        const unsigned char* texel = FetchTexel(level, numComponents, columns[lane], rows[lane]);
+
+        for (int component = 0; component < 3; component++)
+        {
+            texels[component][lane] = texel[std::min(component, numComponents - 1)];
+        }
+    }
+
+    for (int component = 0; component < 3; component++)
+    {
+        color[component] = _mm_load_ps(texels[component]);
+    }
+}
+
+static void FilterBilinearSSE(const TextureLevel& level, int numComponents, TextureAddressMode addressMode, __m128 u,
+                              __m128 v, __m128 color[3])
+{
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 x    = _mm_sub_ps(_mm_mul_ps(u, _mm_set1_ps(static_cast<float>(level.Width))), half);
+    __m128 y    = _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps(static_cast<float>(level.Height))), half);
+
+    __m128 left   = FloorSSE(x);
+    __m128 bottom = FloorSSE(y);
+    __m128 fx     = _mm_sub_ps(x, left);
+    __m128 fy     = _mm_sub_ps(y, bottom);
+
+    __m128i leftTexel   = _mm_cvttps_epi32(left);
+    __m128i bottomTexel = _mm_cvttps_epi32(bottom);
+    __m128i one         = _mm_set1_epi32(1);
+
+    alignas(16) std::int32_t columns[2][4];
+    alignas(16) std::int32_t rows[2][4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(columns[0]), AddressTexelSSE(leftTexel, level.Width, addressMode));
+    _mm_store_si128(reinterpret_cast<__m128i*>(columns[1]),
+                    AddressTexelSSE(_mm_add_epi32(leftTexel, one), level.Width, addressMode));
+    _mm_store_si128(reinterpret_cast<__m128i*>(rows[0]), AddressTexelSSE(bottomTexel, level.Height, addressMode));
+    _mm_store_si128(reinterpret_cast<__m128i*>(rows[1]),
+                    AddressTexelSSE(_mm_add_epi32(bottomTexel, one), level.Height, addressMode));
+
+    // SSE2 has no gather, so the texels are read one lane at a time, into one register per corner and component
+    alignas(16) float texels[4][3][4];
+    for (int lane = 0; lane < 4; lane++)
+    {
+        for (int corner = 0; corner < 4; corner++)
+        {
+            int column = columns[corner & 1][lane];
+            int row    = rows[corner >> 1][lane];
+
+            const unsigned char* texel = FetchTexel(level, numComponents, column, row);
+
+            for (int component = 0; component < 3; component++)
+            {
+                texels[corner][component][lane] = texel[std::min(component, numComponents - 1)];
+            }
+        }
+    }
+
+    __m128 inverseFx  = _mm_sub_ps(_mm_set1_ps(1.0f), fx);
+    __m128 inverseFy  = _mm_sub_ps(_mm_set1_ps(1.0f), fy);
+    __m128 weights[4] = {_mm_mul_ps(inverseFx, inverseFy), _mm_mul_ps(fx, inverseFy), _mm_mul_ps(inverseFx, fy),
+                         _mm_mul_ps(fx, fy)};
+
+    for (int component = 0; component < 3; component++)
+    {
+        __m128 sum = _mm_mul_ps(_mm_load_ps(texels[0][component]), weights[0]);
+        for (int corner = 1; corner < 4; corner++)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(texels[corner][component]), weights[corner]));
+        }
+        color[component] = sum;
+    }
+}
+
+static void SampleTextureSSE(const Texture& texture, const SamplerState& sampler, const LevelBlend& levels,
+                             const float* u, const float* v, TGAColor* colors)
+{
+    __m128 addressedU = ApplyAddressModeSSE(_mm_loadu_ps(u), sampler.AddressMode);
+    __m128 addressedV = ApplyAddressModeSSE(_mm_loadu_ps(v), sampler.AddressMode);
+
+    __m128 color[3];
+
+    if (sampler.Filter == TextureFilter::Nearest)
+    {
+        FilterNearestSSE(GetTextureLevel(texture, 0), texture.NumComponents, addressedU, addressedV, color);
+    }
+    else
+    {
+        FilterBilinearSSE(GetTextureLevel(texture, levels.Level), texture.NumComponents, sampler.AddressMode,
+                          addressedU, addressedV, color);
+
+        if (levels.Blend > 0.0f)
+        {
+            __m128 nextColor[3];
+            FilterBilinearSSE(GetTextureLevel(texture, levels.Level + 1), texture.NumComponents, sampler.AddressMode,
+                              addressedU, addressedV, nextColor);
+
+            __m128 blend = _mm_set1_ps(levels.Blend);
+            for (int component = 0; component < 3; component++)
+            {
+                color[component] =
+                    _mm_add_ps(color[component], _mm_mul_ps(_mm_sub_ps(nextColor[component], color[component]), blend));
+            }
+        }
+    }
+
+    // Rounded the same way as ToColor
+    alignas(16) std::int32_t rounded[3][4];
+    for (int component = 0; component < 3; component++)
+    {
+        _mm_store_si128(reinterpret_cast<__m128i*>(rounded[component]),
+                        _mm_cvttps_epi32(_mm_add_ps(color[component], _mm_set1_ps(0.5f))));
+    }
+
+    for (int lane = 0; lane < 4; lane++)
+    {
+        colors[lane] = TGAColor(static_cast<std::uint8_t>(rounded[0][lane]),
+                                static_cast<std::uint8_t>(rounded[1][lane]),
+                                static_cast<std::uint8_t>(rounded[2][lane]));
+    }
+}
+
+#endif // RENDERER_X86
+
+void SampleTextureBatch(const Texture& texture, const SamplerState& sampler, const float* u, const float* v, float lod,
+                        int count, TGAColor* colors)
+{
+    int first = 0;
+
+#if RENDERER_X86
+    // The level of detail is shared, so the levels to read only need picking once
+    LevelBlend levels = SelectLevels(texture, sampler, lod);
+
+    for (; first + SAMPLE_BATCH_SIZE <= count; first += SAMPLE_BATCH_SIZE)
+    {
+        SampleTextureSSE(texture, sampler, levels, u + first, v + first, colors + first);
+    }
+#endif
+
+    // Whatever is left over, or everything without SIMD
+    for (; first < count; first++)
+    {
+        colors[first] = SampleTexture(texture, sampler, glm::vec2(u[first], v[first]), lod);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include "Utilities/texture.h"
+#include "Utilities/tgaimage.h"
+
+// How the texels around a texture coordinate are turned into a color
+enum class TextureFilter
+{
+    // The single texel the coordinate falls in
+    Nearest,
+    // The four texels around the coordinate, weighted by how close it is to each of them
+    Bilinear,
+    // Bilinear on each of the two mip levels around the level of detail, blended by its fractional part. Textures
+    // without a mip chain are filtered bilinearly.
+    Trilinear,
+};
+
+// What happens to texture coordinates outside of [0, 1]
+enum class TextureAddressMode
+{
+    // The texture repeats
+    Wrap,
+    // The texels on the edges stretch out forever
+    Clamp,
+    // The texture repeats, flipped every other time, so that the repeats meet on the same texels
+    Mirror,
+};
+
+struct SamplerState
+{
+    TextureFilter      Filter      = TextureFilter::Nearest;
+    TextureAddressMode AddressMode = TextureAddressMode::Wrap;
+};
+
+// The number of texture coordinates SampleTextureBatch works on at once
+const int SAMPLE_BATCH_SIZE = 4;
+
+// Samples the first three components of the texture at uv. Grayscale textures have their single component in all
+// three. lod is only used by trilinear filtering, and is clamped to the levels the texture has.
+TGAColor SampleTexture(const Texture& texture, const SamplerState& sampler, const glm::vec2& uv, float lod);
+
+// Same as SampleTexture for count coordinates, given as separate arrays of u and v, which all share the same level of
+// detail. That is the case for all the pixels of a triangle, since its texture coordinates are linear in screen space.
+//
+// The coordinates are worked through SAMPLE_BATCH_SIZE at a time, with the addressing, the filter weights and the
+// blending done for all of them at once with SIMD instructions where available. The results are exactly the same as
+// sampling one coordinate at a time.
+void SampleTextureBatch(const Texture& texture, const SamplerState& sampler, const float* u, const float* v, float lod,
+                        int count, TGAColor* colors);
@@ -0,0 +1,152 @@
+// The body of the SIMD rasterizer, written once against a "Wide" type that wraps the intrinsics of one instruction
+// set. simdrasterizer.cpp includes this file once per instruction set, each time inside its own namespace and with the
+// compiler targeting that instruction set, so every copy gets compiled with the right instructions.
+//
+// Expects Wide to provide the Width of its vectors, the Int, Float and Mask types, and the operations used below.
+
+// Rasterizes the pixels [x, x + Width) of a row, given the edge function values of those pixels. validLanes is the
+// number of those pixels that are actually inside the bounding box.
+static inline void DrawPixels(const Triangle& triangle, const ShadingState& shading, const TriangleSetup& setup,
+                              const Wide::Int& e0, const Wide::Int& e1, const Wide::Int& e2, int validLanes,
+                              float* depth, std::uint8_t* pixel, int bytesPerPixel)
+{
+    using Float = Wide::Float;
+    using Mask  = Wide::Mask;
+
+    // A pixel is inside when all three edge functions are <= 0, so it is outside if any of them is > 0
+    Mask outside =
+        Wide::Or(Wide::GreaterThanZero(e0), Wide::Or(Wide::GreaterThanZero(e1), Wide::GreaterThanZero(e2)));
+    Mask covered = Wide::AndNot(outside, Wide::FirstLanes(validLanes));
+
+    if (Wide::ToBits(covered) == 0)
+    {
+        return;
+    }
+
+    // Same operations in the same order as the scalar backends, so the depths match them exactly
+    Float z = Wide::Add(Wide::Add(Wide::Mul(Wide::Set(setup.Z[0]), Wide::ToFloat(e0)),
+                                  Wide::Mul(Wide::Set(setup.Z[1]), Wide::ToFloat(e1))),
+                        Wide::Mul(Wide::Set(setup.Z[2]), Wide::ToFloat(e2)));
+
+    // The last group of a row can hang over the end of the bounding box. Those pixels may belong to another tile that
+    // is being drawn at the same time, so they must not be touched at all, not even read.
+    alignas(64) float depthValues[Wide::Width];
+    bool              isFullGroup = validLanes == Wide::Width;
+
+    Float storedDepth;
+    if (isFullGroup)
+    {
+        storedDepth = Wide::Load(depth);
+    }
+    else
+    {
+        for (int lane = 0; lane < validLanes; lane++)
+        {
+            depthValues[lane] = depth[lane];
+        }
+        storedDepth = Wide::LoadAligned(depthValues);
+    }
+
+    Mask passed     = Wide::And(covered, Wide::LessThan(storedDepth, z));
+    int  passedBits = Wide::ToBits(passed);
+
+    if (passedBits == 0)
+    {
+        return;
+    }
+
+    Float newDepth = Wide::Select(passed, z, storedDepth);
+    if (isFullGroup)
+    {
+        Wide::Store(depth, newDepth);
+    }
+    else
+    {
+        Wide::StoreAligned(depthValues, newDepth);
+        for (int lane = 0; lane < validLanes; lane++)
+        {
+            depth[lane] = depthValues[lane];
+        }
+    }
+
+    // Shading stays scalar, only for the pixels that made it through the depth test
+    alignas(64) std::int32_t edgeValues[3][Wide::Width];
+    Wide::StoreAligned(edgeValues[0], e0);
+    Wide::StoreAligned(edgeValues[1], e1);
+    Wide::StoreAligned(edgeValues[2], e2);
+
+    for (int lane = 0; lane < Wide::Width; lane++)
+    {
+        if ((passedBits & (1 << lane)) == 0)
+        {
+            continue;
+        }
+
+        float w0 = edgeValues[0][lane] * setup.InverseArea;
+        float w1 = edgeValues[1][lane] * setup.InverseArea;
+        float w2 = edgeValues[2][lane] * setup.InverseArea;
+
+        TGAColor color;
+        if (ShadeFragment(triangle, shading, w0, w1, w2, color))
+        {
+            std::memcpy(pixel + lane * bytesPerPixel, color.bgra, bytesPerPixel);
+        }
+    }
+}
+
+static void DrawTriangle(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                         const TriangleSetup& setup)
+{
+    using Int = Wide::Int;
+
+    const PixelRect& bbox = setup.BoundingBox;
+
+    // The values of every edge function for the lanes of a group relative to its first pixel, and how much they
+    // change when moving on to the next group
+    alignas(64) std::int32_t laneOffsets[3][Wide::Width];
+    Int                      laneStep[3];
+    Int                      groupStep[3];
+
+    for (int edge = 0; edge < 3; edge++)
+    {
+        for (int lane = 0; lane < Wide::Width; lane++)
+        {
+            laneOffsets[edge][lane] = static_cast<std::int32_t>(setup.Edges[edge].StepX * lane);
+        }
+        laneStep[edge]  = Wide::LoadAligned(laneOffsets[edge]);
+        groupStep[edge] = Wide::Set(static_cast<std::int32_t>(setup.Edges[edge].StepX * Wide::Width));
+    }
+
+    int    bytesPerPixel = frameBuffer.Image->get_bytespp();
+    size_t firstPixel    = bbox.MinX + static_cast<size_t>(bbox.MinY) * frameBuffer.Width;
+
+    float*        depthRow = frameBuffer.ZBuffer + firstPixel;
+    std::uint8_t* colorRow = frameBuffer.Image->buffer() + firstPixel * bytesPerPixel;
+
+    for (int y = bbox.MinY; y <= bbox.MaxY; y++)
+    {
+        Int e0 = Wide::Add(Wide::Set(static_cast<std::int32_t>(setup.Edges[0].Evaluate(bbox.MinX, y))), laneStep[0]);
+        Int e1 = Wide::Add(Wide::Set(static_cast<std::int32_t>(setup.Edges[1].Evaluate(bbox.MinX, y))), laneStep[1]);
+        Int e2 = Wide::Add(Wide::Set(static_cast<std::int32_t>(setup.Edges[2].Evaluate(bbox.MinX, y))), laneStep[2]);
+
+        float*        depth = depthRow;
+        std::uint8_t* pixel = colorRow;
+
+        for (int x = bbox.MinX; x <= bbox.MaxX; x += Wide::Width)
+        {
+            int validLanes = std::min(Wide::Width, bbox.MaxX - x + 1);
+
+            DrawPixels(triangle, shading, setup, e0, e1, e2, validLanes, depth, pixel, bytesPerPixel);
+
+            e0 = Wide::Add(e0, groupStep[0]);
+            e1 = Wide::Add(e1, groupStep[1]);
+            e2 = Wide::Add(e2, groupStep[2]);
+
+            depth += Wide::Width;
+            pixel += Wide::Width * bytesPerPixel;
+        }
+
+        depthRow += frameBuffer.Width;
+        colorRow += static_cast<size_t>(frameBuffer.Width) * bytesPerPixel;
+    }
+}
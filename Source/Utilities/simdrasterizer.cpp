@@ -0,0 +1,284 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "Utilities/cpufeatures.h"
+#include "Utilities/trianglesetup.h"
+
+#if RENDERER_X86
+#include <immintrin.h>
+
+// Each of the kernels below is compiled for its own instruction set, independently of the flags the rest of the
+// project is built with, and only gets called once the CPU has been checked for that instruction set. MSVC allows
+// intrinsics of any instruction set anywhere, GCC and Clang need to be told which code may use them.
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+namespace SSE2
+{
+struct Wide
+{
+    static constexpr int Width = 4;
+
+    using Int   = __m128i;
+    using Float = __m128;
+    using Mask  = __m128i;
+
+    static inline Int   Set(std::int32_t value) { return _mm_set1_epi32(value); }
+    static inline Float Set(float value) { return _mm_set1_ps(value); }
+    static inline Int   Add(Int a, Int b) { return _mm_add_epi32(a, b); }
+    static inline Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static inline Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static inline Float ToFloat(Int value) { return _mm_cvtepi32_ps(value); }
+
+    static inline Float Load(const float* source) { return _mm_loadu_ps(source); }
+    static inline Float LoadAligned(const float* source) { return _mm_load_ps(source); }
+    static inline Int   LoadAligned(const std::int32_t* source) { return _mm_load_si128((const __m128i*)source); }
+    static inline void  Store(float* destination, Float value) { _mm_storeu_ps(destination, value); }
+    static inline void  StoreAligned(float* destination, Float value) { _mm_store_ps(destination, value); }
+    static inline void  StoreAligned(std::int32_t* destination, Int value)
+    {
+        _mm_store_si128((__m128i*)destination, value);
+    }
+
+    static inline Mask GreaterThanZero(Int value) { return _mm_cmpgt_epi32(value, _mm_setzero_si128()); }
+    static inline Mask LessThan(Float a, Float b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+    static inline Mask FirstLanes(int count)
+    {
+        return _mm_cmpgt_epi32(_mm_set1_epi32(count), _mm_setr_epi32(0, 1, 2, 3));
+    }
+    static inline Mask Or(Mask a, Mask b) { return _mm_or_si128(a, b); }
+    static inline Mask And(Mask a, Mask b) { return _mm_and_si128(a, b); }
+    // b with the lanes of a removed
+    static inline Mask AndNot(Mask a, Mask b) { return _mm_andnot_si128(a, b); }
+    static inline int  ToBits(Mask mask) { return _mm_movemask_ps(_mm_castsi128_ps(mask)); }
+
+    // a where mask is set, b everywhere else
+    static inline Float Select(Mask mask, Float a, Float b)
+    {
+        __m128 floatMask = _mm_castsi128_ps(mask);
+        return _mm_or_ps(_mm_and_ps(floatMask, a), _mm_andnot_ps(floatMask, b));
+    }
+};
+
+#include "Utilities/simdkernel.inl"
+} // namespace SSE2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace AVX2
+{
+struct Wide
+{
+    static constexpr int Width = 8;
+
+    using Int   = __m256i;
+    using Float = __m256;
+    using Mask  = __m256i;
+
+    static inline Int   Set(std::int32_t value) { return _mm256_set1_epi32(value); }
+    static inline Float Set(float value) { return _mm256_set1_ps(value); }
+    static inline Int   Add(Int a, Int b) { return _mm256_add_epi32(a, b); }
+    static inline Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static inline Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static inline Float ToFloat(Int value) { return _mm256_cvtepi32_ps(value); }
+
+    static inline Float Load(const float* source) { return _mm256_loadu_ps(source); }
+    static inline Float LoadAligned(const float* source) { return _mm256_load_ps(source); }
+    static inline Int   LoadAligned(const std::int32_t* source) { return _mm256_load_si256((const __m256i*)source); }
+    static inline void  Store(float* destination, Float value) { _mm256_storeu_ps(destination, value); }
+    static inline void  StoreAligned(float* destination, Float value) { _mm256_store_ps(destination, value); }
+    static inline void  StoreAligned(std::int32_t* destination, Int value)
+    {
+        _mm256_store_si256((__m256i*)destination, value);
+    }
+
+    static inline Mask GreaterThanZero(Int value) { return _mm256_cmpgt_epi32(value, _mm256_setzero_si256()); }
+    static inline Mask LessThan(Float a, Float b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+    static inline Mask FirstLanes(int count)
+    {
+        return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    }
+    static inline Mask Or(Mask a, Mask b) { return _mm256_or_si256(a, b); }
+    static inline Mask And(Mask a, Mask b) { return _mm256_and_si256(a, b); }
+    // b with the lanes of a removed
+    static inline Mask AndNot(Mask a, Mask b) { return _mm256_andnot_si256(a, b); }
+    static inline int  ToBits(Mask mask) { return _mm256_movemask_ps(_mm256_castsi256_ps(mask)); }
+
+    // a where mask is set, b everywhere else
+    static inline Float Select(Mask mask, Float a, Float b)
+    {
+        return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask));
+    }
+};
+
+#include "Utilities/simdkernel.inl"
+} // namespace AVX2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// AVX-512 implies FMA, and GCC would otherwise fuse the depth interpolation into FMAs that round differently from
+// the scalar backends
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace AVX512
+{
+struct Wide
+{
+    static constexpr int Width = 16;
+
+    using Int   = __m512i;
+    using Float = __m512;
+    // AVX-512 has dedicated mask registers with one bit per lane
+    using Mask = __mmask16;
+
+    static inline Int   Set(std::int32_t value) { return _mm512_set1_epi32(value); }
+    static inline Float Set(float value) { return _mm512_set1_ps(value); }
+    static inline Int   Add(Int a, Int b) { return _mm512_add_epi32(a, b); }
+    static inline Float Add(Float a, Float b) { return _mm512_add_ps(a, b); }
+    static inline Float Mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+    static inline Float ToFloat(Int value) { return _mm512_cvtepi32_ps(value); }
+
+    static inline Float Load(const float* source) { return _mm512_loadu_ps(source); }
+    static inline Float LoadAligned(const float* source) { return _mm512_load_ps(source); }
+    static inline Int   LoadAligned(const std::int32_t* source) { return _mm512_load_si512(source); }
+    static inline void  Store(float* destination, Float value) { _mm512_storeu_ps(destination, value); }
+    static inline void  StoreAligned(float* destination, Float value) { _mm512_store_ps(destination, value); }
+    static inline void  StoreAligned(std::int32_t* destination, Int value) { _mm512_store_si512(destination, value); }
+
+    static inline Mask GreaterThanZero(Int value) { return _mm512_cmpgt_epi32_mask(value, _mm512_setzero_si512()); }
+    static inline Mask LessThan(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static inline Mask FirstLanes(int count) { return static_cast<Mask>((1u << count) - 1); }
+    static inline Mask Or(Mask a, Mask b) { return static_cast<Mask>(a | b); }
+    static inline Mask And(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+    // b with the lanes of a removed
+    static inline Mask AndNot(Mask a, Mask b) { return static_cast<Mask>(~a & b); }
+    static inline int  ToBits(Mask mask) { return static_cast<int>(mask); }
+
+    // a where mask is set, b everywhere else
+    static inline Float Select(Mask mask, Float a, Float b) { return _mm512_mask_blend_ps(mask, b, a); }
+};
+
+#include "Utilities/simdkernel.inl"
+} // namespace AVX512
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif // RENDERER_X86
+
+static SimdLevel s_SimdLevel = GetBestSimdLevel();
+
+void SetSimdLevel(SimdLevel level)
+{
+    // Never go wider than what the CPU can actually run
+    s_SimdLevel = std::min(level, GetBestSimdLevel());
+}
+
+SimdLevel GetSimdLevel()
+{
+    return s_SimdLevel;
+}
+
+// The SIMD kernels step the edge functions in 32 bit lanes. Since the edge functions are linear, checking the corners
+// of the area the lanes sweep over (the bounding box, plus the padding of the last group of each row) is enough to
+// know whether all the values along the way fit.
+static bool EdgesFitIn32Bits(const TriangleSetup& setup)
+{
+    const int maxWidth = 16;
+
+    const PixelRect& bbox = setup.BoundingBox;
+
+    int cornersX[2] = {bbox.MinX, bbox.MaxX + maxWidth - 1};
+    int cornersY[2] = {bbox.MinY, bbox.MaxY};
+
+    for (const EdgeEquation& edge : setup.Edges)
+    {
+        if (std::abs(edge.StepX * maxWidth) > std::numeric_limits<std::int32_t>::max())
+        {
+            return false;
+        }
+
+        for (int x : cornersX)
+        {
+            for (int y : cornersY)
+            {
+                int64_t value = edge.Evaluate(x, y);
+                if (value > std::numeric_limits<std::int32_t>::max() ||
+                    value < std::numeric_limits<std::int32_t>::min())
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void DrawTriangleSIMD(const Triangle& triangle, const ShadingState& shading, FrameBuffer& frameBuffer,
+                      const PixelRect& clipRect)
+{
+    TriangleSetup setup;
+    if (!SetupTriangle(triangle, clipRect, setup))
+    {
+        return;
+    }
+
+    if (!EdgesFitIn32Bits(setup))
+    {
+        DrawTriangleScanline(triangle, shading, frameBuffer, clipRect);
+        return;
+    }
+
+    switch (s_SimdLevel)
+    {
+#if RENDERER_X86
+    case SimdLevel::AVX512:
+        AVX512::DrawTriangle(triangle, shading, frameBuffer, setup);
+        break;
+    case SimdLevel::AVX2:
+        AVX2::DrawTriangle(triangle, shading, frameBuffer, setup);
+        break;
+    case SimdLevel::SSE2:
+        SSE2::DrawTriangle(triangle, shading, frameBuffer, setup);
+        break;
+#endif
+    default:
+        DrawTriangleScanline(triangle, shading, frameBuffer, clipRect);
+        break;
+    }
+}
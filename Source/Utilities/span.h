@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// A view of count consecutive elements somewhere in memory, owned by someone else: a vector, a memory mapped file or
+// anything else that keeps the elements alive for as long as the view is used. Lets the same code read arrays no
+// matter where they are stored, without copying them. A minimal stand-in for C++20's std::span.
+template <typename T>
+class Span
+{
+
+  public:
+    using value_type = std::remove_const_t<T>;
+
+    Span() : m_Data(nullptr), m_Size(0) {}
+    Span(T* data, std::size_t size) : m_Data(data), m_Size(size) {}
+
+    template <typename Allocator>
+    Span(std::vector<value_type, Allocator>& vector) : m_Data(vector.data()), m_Size(vector.size())
+    {
+    }
+
+    // Only usable for views of const elements
+    template <typename Allocator>
+    Span(const std::vector<value_type, Allocator>& vector) : m_Data(vector.data()), m_Size(vector.size())
+    {
+    }
+
+    // A view of non-const elements can be turned into a view of const ones
+    template <typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+    Span(const Span<U>& other) : m_Data(other.data()), m_Size(other.size())
+    {
+    }
+
+    inline T&          operator[](std::size_t index) const { return m_Data[index]; }
+    inline T*          data() const { return m_Data; }
+    inline std::size_t size() const { return m_Size; }
+    inline bool        empty() const { return m_Size == 0; }
+    inline T*          begin() const { return m_Data; }
+    inline T*          end() const { return m_Data + m_Size; }
+
+  private:
+    T*          m_Data;
+    std::size_t m_Size;
+};
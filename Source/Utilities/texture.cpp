@@ -0,0 +1,700 @@
+#include "texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image/stb_image.h>
+
+const int TEXELS_PER_BLOCK = TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE;
+
+// The 16 bit 5:6:5 color nearest to an 8 bit one, and back
+static inline unsigned int PackColor(const int color[3])
+{
+    unsigned int red   = (color[0] * 31 + 127) / 255;
+    unsigned int green = (color[1] * 63 + 127) / 255;
+    unsigned int blue  = (color[2] * 31 + 127) / 255;
+
+    return red << 11 | green << 5 | blue;
+}
+
+static inline void UnpackColor(unsigned int packed, int color[3])
+{
+    // The top bits are repeated into the bottom ones, so that 0 and the largest value map to 0 and 255
+    int red   = packed >> 11 & 31;
+    int green = packed >> 5 & 63;
+    int blue  = packed & 31;
+
+    color[0] = red << 3 | red >> 2;
+    color[1] = green << 2 | green >> 4;
+    color[2] = blue << 3 | blue >> 2;
+}
+
+// The four colors a BC1 block picks from, given its two endpoints. With the first endpoint the larger one, the other
+// two are a third and two thirds of the way between them. Otherwise the third is halfway and the fourth is black.
+static void GetColorPalette(unsigned int endpoint0, unsigned int endpoint1, int palette[4][3])
+{
+    UnpackColor(endpoint0, palette[0]);
+    UnpackColor(endpoint1, palette[1]);
+
+    for (int component = 0; component < 3; component++)
+    {
+        int color0 = palette[0][component];
+        int color1 = palette[1][component];
+
+        if (endpoint0 > endpoint1)
+        {
+            palette[2][component] = (2 * color0 + color1) / 3;
+            palette[3][component] = (color0 + 2 * color1) / 3;
+        }
+        else
+        {
+            palette[2][component] = (color0 + color1) / 2;
+            palette[3][component] = 0;
+        }
+    }
+}
+
+// Picks the palette color nearest to every texel of a tile, for the given endpoints, which are swapped first if needed
+// so that the first one is the larger. Returns the squared error of the tile.
+static int ChooseColorIndices(const unsigned char* texels, int numComponents, unsigned int& endpoint0,
+                              unsigned int& endpoint1, std::uint32_t& indices)
+{
+    if (endpoint0 < endpoint1)
+    {
+        std::swap(endpoint0, endpoint1);
+    }
+
+    int palette[4][3];
+    GetColorPalette(endpoint0, endpoint1, palette);
+
+    // With both endpoints the same, the palette has a single color in the first place
+    int numColors = endpoint0 != endpoint1 ? 4 : 1;
+
+    indices   = 0;
+    int error = 0;
+    for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+    {
+        const unsigned char* color = texels + texel * numComponents;
+
+        int bestIndex = 0, bestDistance = std::numeric_limits<int>::max();
+        for (int index = 0; index < numColors; index++)
+        {
+            int distance = 0;
+            for (int component = 0; component < 3; component++)
+            {
+                int difference = color[component] - palette[index][component];
+                distance += difference * difference;
+            }
+            if (distance < bestDistance)
+            {
+                bestIndex    = index;
+                bestDistance = distance;
+            }
+        }
+
+        indices |= static_cast<std::uint32_t>(bestIndex) << (texel * 2);
+        error += bestDistance;
+    }
+
+    return error;
+}
+
+// For every 8 bit value, the pair of 5 bit (or 6 bit) endpoints whose color a third of the way between them is the
+// nearest to it. A tile of a single color is encoded with those, which is far closer than rounding it to 5:6:5.
+struct SingleColorEndpoints
+{
+    unsigned char Endpoints[2][256][2];
+
+    SingleColorEndpoints()
+    {
+        for (int green = 0; green < 2; green++)
+        {
+            int bits = green ? 6 : 5;
+            int max  = (1 << bits) - 1;
+
+            for (int value = 0; value < 256; value++)
+            {
+                int bestError = std::numeric_limits<int>::max();
+                for (int endpoint0 = 0; endpoint0 <= max; endpoint0++)
+                {
+                    for (int endpoint1 = 0; endpoint1 <= max; endpoint1++)
+                    {
+                        // Expanded the same way as UnpackColor
+                        int color0 = endpoint0 << (8 - bits) | endpoint0 >> (2 * bits - 8);
+                        int color1 = endpoint1 << (8 - bits) | endpoint1 >> (2 * bits - 8);
+                        int error  = std::abs((2 * color0 + color1) / 3 - value);
+
+                        if (error < bestError)
+                        {
+                            bestError                  = error;
+                            Endpoints[green][value][0] = static_cast<unsigned char>(endpoint0);
+                            Endpoints[green][value][1] = static_cast<unsigned char>(endpoint1);
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+// Compresses the first three components of a tile the way BC1 does: two endpoint colors, and 2 bits per texel to
+// pick one of the colors of their palette. The endpoints start out as the two texels furthest apart along the
+// direction the colors of the tile vary the most in, and are then moved to where they fit the texels best.
+static void EncodeColorBlock(const unsigned char* texels, int numComponents, unsigned char* block)
+{
+    bool isSingleColor = true;
+    for (int texel = 1; texel < TEXELS_PER_BLOCK; texel++)
+    {
+        isSingleColor = isSingleColor && std::memcmp(texels, texels + texel * numComponents, 3) == 0;
+    }
+
+    unsigned int  endpoint0, endpoint1;
+    std::uint32_t indices;
+
+    if (isSingleColor)
+    {
+        // Built the first time it is needed, which is thread safe
+        static const SingleColorEndpoints singleColor;
+
+        const unsigned char* red   = singleColor.Endpoints[0][texels[0]];
+        const unsigned char* green = singleColor.Endpoints[1][texels[1]];
+        const unsigned char* blue  = singleColor.Endpoints[0][texels[2]];
+
+        endpoint0 = red[0] << 11 | green[0] << 5 | blue[0];
+        endpoint1 = red[1] << 11 | green[1] << 5 | blue[1];
+
+        // Every texel takes the color a third of the way from the first endpoint, which is the fourth one of the
+        // palette once the endpoints are swapped, and the only one if they are the same
+        bool isSwapped = endpoint0 < endpoint1;
+        if (isSwapped)
+        {
+            std::swap(endpoint0, endpoint1);
+        }
+        indices = endpoint0 == endpoint1 ? 0x00000000u : isSwapped ? 0xffffffffu : 0xaaaaaaaau;
+    }
+    else
+    {
+        float mean[3] = {};
+        for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+        {
+            for (int component = 0; component < 3; component++)
+            {
+                mean[component] += texels[texel * numComponents + component] / static_cast<float>(TEXELS_PER_BLOCK);
+            }
+        }
+
+        float covariance[3][3] = {};
+        for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+        {
+            float offset[3];
+            for (int component = 0; component < 3; component++)
+            {
+                offset[component] = texels[texel * numComponents + component] - mean[component];
+            }
+            for (int row = 0; row < 3; row++)
+            {
+                for (int column = 0; column < 3; column++)
+                {
+                    covariance[row][column] += offset[row] * offset[column];
+                }
+            }
+        }
+
+        // A few rounds of power iteration are enough to find the main direction, starting from the gray diagonal
+        float axis[3] = {1.0f, 1.0f, 1.0f};
+        for (int iteration = 0; iteration < 4; iteration++)
+        {
+            float next[3];
+            for (int row = 0; row < 3; row++)
+            {
+                next[row] = covariance[row][0] * axis[0] + covariance[row][1] * axis[1] + covariance[row][2] * axis[2];
+            }
+
+            float length = std::max(std::max(std::abs(next[0]), std::abs(next[1])), std::abs(next[2]));
+            if (length == 0.0f)
+            {
+                break;
+            }
+            for (int component = 0; component < 3; component++)
+            {
+                axis[component] = next[component] / length;
+            }
+        }
+
+        int   lowest = 0, highest = 0;
+        float lowestProjection  = std::numeric_limits<float>::max();
+        float highestProjection = std::numeric_limits<float>::lowest();
+        for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+        {
+            const unsigned char* color = texels + texel * numComponents;
+
+            float projection = color[0] * axis[0] + color[1] * axis[1] + color[2] * axis[2];
+            if (projection < lowestProjection)
+            {
+                lowestProjection = projection;
+                lowest           = texel;
+            }
+            if (projection > highestProjection)
+            {
+                highestProjection = projection;
+                highest           = texel;
+            }
+        }
+
+        int highestColor[3], lowestColor[3];
+        for (int component = 0; component < 3; component++)
+        {
+            highestColor[component] = texels[highest * numComponents + component];
+            lowestColor[component]  = texels[lowest * numComponents + component];
+        }
+
+        endpoint0 = PackColor(highestColor);
+        endpoint1 = PackColor(lowestColor);
+        int error = ChooseColorIndices(texels, numComponents, endpoint0, endpoint1, indices);
+
+        // The endpoints that fit the texels best for the colors they picked, by least squares. Every texel is a mix of
+        // the two endpoints, weighted by where its palette color lies between them.
+        const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+        float weight00 = 0.0f, weight01 = 0.0f, weight11 = 0.0f;
+        float sum0[3]  = {}, sum1[3] = {};
+        for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+        {
+            float weight0 = weights[indices >> (texel * 2) & 3];
+            float weight1 = 1.0f - weight0;
+
+            weight00 += weight0 * weight0;
+            weight01 += weight0 * weight1;
+            weight11 += weight1 * weight1;
+            for (int component = 0; component < 3; component++)
+            {
+                sum0[component] += weight0 * texels[texel * numComponents + component];
+                sum1[component] += weight1 * texels[texel * numComponents + component];
+            }
+        }
+
+        // Zero when all the texels picked the same color, which leaves nothing to fit
+        float determinant = weight00 * weight11 - weight01 * weight01;
+        if (std::abs(determinant) > 1e-6f)
+        {
+            int fitted0[3], fitted1[3];
+            for (int component = 0; component < 3; component++)
+            {
+                float color0 = (sum0[component] * weight11 - sum1[component] * weight01) / determinant;
+                float color1 = (sum1[component] * weight00 - sum0[component] * weight01) / determinant;
+
+                fitted0[component] = static_cast<int>(std::min(std::max(color0, 0.0f), 255.0f) + 0.5f);
+                fitted1[component] = static_cast<int>(std::min(std::max(color1, 0.0f), 255.0f) + 0.5f);
+            }
+
+            unsigned int  fittedEndpoint0 = PackColor(fitted0);
+            unsigned int  fittedEndpoint1 = PackColor(fitted1);
+            std::uint32_t fittedIndices;
+            if (ChooseColorIndices(texels, numComponents, fittedEndpoint0, fittedEndpoint1, fittedIndices) < error)
+            {
+                endpoint0 = fittedEndpoint0;
+                endpoint1 = fittedEndpoint1;
+                indices   = fittedIndices;
+            }
+        }
+    }
+
+    block[0] = static_cast<unsigned char>(endpoint0);
+    block[1] = static_cast<unsigned char>(endpoint0 >> 8);
+    block[2] = static_cast<unsigned char>(endpoint1);
+    block[3] = static_cast<unsigned char>(endpoint1 >> 8);
+    for (int byte = 0; byte < 4; byte++)
+    {
+        block[4 + byte] = static_cast<unsigned char>(indices >> (byte * 8));
+    }
+}
+
+static void DecodeColorBlock(const unsigned char* block, int numComponents, unsigned char* texels)
+{
+    unsigned int endpoint0 = block[0] | block[1] << 8;
+    unsigned int endpoint1 = block[2] | block[3] << 8;
+
+    int palette[4][3];
+    GetColorPalette(endpoint0, endpoint1, palette);
+
+    std::uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | static_cast<std::uint32_t>(block[7]) << 24;
+    for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+    {
+        const int* color = palette[indices >> (texel * 2) & 3];
+        for (int component = 0; component < 3; component++)
+        {
+            texels[texel * numComponents + component] = static_cast<unsigned char>(color[component]);
+        }
+    }
+}
+
+// The eight values a BC4 block picks from, given its two endpoints. With the first endpoint the larger one, the other
+// six are spread evenly between them. Otherwise four are, and the last two are 0 and 255.
+static void GetChannelPalette(int endpoint0, int endpoint1, int palette[8])
+{
+    palette[0] = endpoint0;
+    palette[1] = endpoint1;
+
+    if (endpoint0 > endpoint1)
+    {
+        for (int index = 2; index < 8; index++)
+        {
+            palette[index] = ((8 - index) * endpoint0 + (index - 1) * endpoint1) / 7;
+        }
+        return;
+    }
+
+    for (int index = 2; index < 6; index++)
+    {
+        palette[index] = ((6 - index) * endpoint0 + (index - 1) * endpoint1) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+}
+
+// Compresses a single component of a tile the way BC4 does: its smallest and largest values as the endpoints, and 3
+// bits per texel to pick one of the values of their palette
+static void EncodeChannelBlock(const unsigned char* texels, int numComponents, int component, unsigned char* block)
+{
+    int endpoint0 = 0, endpoint1 = 255;
+    for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+    {
+        endpoint0 = std::max(endpoint0, static_cast<int>(texels[texel * numComponents + component]));
+        endpoint1 = std::min(endpoint1, static_cast<int>(texels[texel * numComponents + component]));
+    }
+
+    int palette[8];
+    GetChannelPalette(endpoint0, endpoint1, palette);
+
+    std::uint64_t indices = 0;
+    for (int texel = 0; endpoint0 != endpoint1 && texel < TEXELS_PER_BLOCK; texel++)
+    {
+        int value = texels[texel * numComponents + component];
+
+        int bestIndex = 0, bestDistance = 256;
+        for (int index = 0; index < 8; index++)
+        {
+            int distance = std::abs(value - palette[index]);
+            if (distance < bestDistance)
+            {
+                bestIndex    = index;
+                bestDistance = distance;
+            }
+        }
+
+        indices |= static_cast<std::uint64_t>(bestIndex) << (texel * 3);
+    }
+
+    block[0] = static_cast<unsigned char>(endpoint0);
+    block[1] = static_cast<unsigned char>(endpoint1);
+    for (int byte = 0; byte < 6; byte++)
+    {
+        block[2 + byte] = static_cast<unsigned char>(indices >> (byte * 8));
+    }
+}
+
+static void DecodeChannelBlock(const unsigned char* block, int numComponents, int component, unsigned char* texels)
+{
+    int palette[8];
+    GetChannelPalette(block[0], block[1], palette);
+
+    std::uint64_t indices = 0;
+    for (int byte = 0; byte < 6; byte++)
+    {
+        indices |= static_cast<std::uint64_t>(block[2 + byte]) << (byte * 8);
+    }
+
+    for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+    {
+        texels[texel * numComponents + component] = static_cast<unsigned char>(palette[indices >> (texel * 3) & 7]);
+    }
+}
+
+// Compresses the texels of a tile, given row by row, with the first 8 bytes of the block for the color or the gray
+// component, and the next 8 for alpha
+static void EncodeTextureBlock(const unsigned char* texels, int numComponents, unsigned char* block)
+{
+    bool hasColor = numComponents >= 3;
+    if (hasColor)
+    {
+        EncodeColorBlock(texels, numComponents, block);
+    }
+    else
+    {
+        EncodeChannelBlock(texels, numComponents, 0, block);
+    }
+
+    if (numComponents == 2 || numComponents == 4)
+    {
+        EncodeChannelBlock(texels, numComponents, numComponents - 1, block + 8);
+    }
+}
+
+void DecodeTextureBlock(const unsigned char* block, int numComponents, unsigned char* texels)
+{
+    bool hasColor = numComponents >= 3;
+    if (hasColor)
+    {
+        DecodeColorBlock(block, numComponents, texels);
+    }
+    else
+    {
+        DecodeChannelBlock(block, numComponents, 0, texels);
+    }
+
+    if (numComponents == 2 || numComponents == 4)
+    {
+        DecodeChannelBlock(block + 8, numComponents, numComponents - 1, texels);
+    }
+}
+
+// Compresses the texels of a level in another layout. Tiles that go past the edges of the level are filled with the
+// texels on the edges, so that the padding doesn't pull the colors of the tile away from the ones that are used.
+static void CompressTexels(const unsigned char* source, TextureLayout sourceLayout, unsigned char* destination,
+                           int width, int height, int numComponents)
+{
+    unsigned char texels[TEXELS_PER_BLOCK * 4];
+
+    for (int top = 0; top < height; top += TEXTURE_TILE_SIZE)
+    {
+        for (int left = 0; left < width; left += TEXTURE_TILE_SIZE)
+        {
+            for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+            {
+                int x = std::min(left + texel % static_cast<int>(TEXTURE_TILE_SIZE), width - 1);
+                int y = std::min(top + texel / static_cast<int>(TEXTURE_TILE_SIZE), height - 1);
+
+                std::memcpy(texels + texel * numComponents,
+                            source + GetTexelIndex(sourceLayout, width, x, y) * numComponents, numComponents);
+            }
+
+            EncodeTextureBlock(texels, numComponents, destination + GetBlockOffset(width, numComponents, left, top));
+        }
+    }
+}
+
+// Decodes the texels of a compressed level into another layout
+static void DecompressTexels(const unsigned char* source, unsigned char* destination, TextureLayout destinationLayout,
+                             int width, int height, int numComponents)
+{
+    unsigned char texels[TEXELS_PER_BLOCK * 4];
+
+    for (int top = 0; top < height; top += TEXTURE_TILE_SIZE)
+    {
+        for (int left = 0; left < width; left += TEXTURE_TILE_SIZE)
+        {
+            DecodeTextureBlock(source + GetBlockOffset(width, numComponents, left, top), numComponents, texels);
+
+            for (int texel = 0; texel < TEXELS_PER_BLOCK; texel++)
+            {
+                int x = left + texel % static_cast<int>(TEXTURE_TILE_SIZE);
+                int y = top + texel / static_cast<int>(TEXTURE_TILE_SIZE);
+
+                if (x < width && y < height)
+                {
+                    std::memcpy(destination + GetTexelIndex(destinationLayout, width, x, y) * numComponents,
+                                texels + texel * numComponents, numComponents);
+                }
+            }
+        }
+    }
+}
+
+// Copies the texels of a level from one layout to another, compressing or decoding them on the way if either layout is
+// Compressed. The padding of a tiled destination is left as it is.
+static void CopyTexels(const unsigned char* source, TextureLayout sourceLayout, unsigned char* destination,
+                       TextureLayout destinationLayout, int width, int height, int numComponents)
+{
+    if (sourceLayout == TextureLayout::Compressed)
+    {
+        DecompressTexels(source, destination, destinationLayout, width, height, numComponents);
+        return;
+    }
+    if (destinationLayout == TextureLayout::Compressed)
+    {
+        CompressTexels(source, sourceLayout, destination, width, height, numComponents);
+        return;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            std::memcpy(destination + GetTexelIndex(destinationLayout, width, x, y) * numComponents,
+                        source + GetTexelIndex(sourceLayout, width, x, y) * numComponents, numComponents);
+        }
+    }
+}
+
+// The texels of a level in another layout
+static std::vector<unsigned char> ConvertTexels(const unsigned char* source, TextureLayout sourceLayout,
+                                                TextureLayout layout, int width, int height, int numComponents)
+{
+    std::vector<unsigned char> texels(GetLevelSize(layout, width, height, numComponents));
+    CopyTexels(source, sourceLayout, texels.data(), layout, width, height, numComponents);
+    return texels;
+}
+
+std::shared_ptr<Texture> DecodeTexture(const std::string& filename, TextureLayout layout)
+{
+    // The flag is per thread, so textures decoding on other threads at the same time don't get in each other's way
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    int            width, height, numComponents;
+    unsigned char* pixels = stbi_load(filename.c_str(), &width, &height, &numComponents, 0);
+
+    if (pixels == NULL)
+    {
+        return nullptr;
+    }
+
+    if (layout == TextureLayout::RowMajor)
+    {
+        // The texture points straight at the decoded image, which goes away along with it
+        return std::shared_ptr<Texture>(new Texture{pixels, width, height, numComponents}, [pixels](Texture* texture) {
+            stbi_image_free(pixels);
+            delete texture;
+        });
+    }
+
+    auto texture = std::make_shared<Texture>(Texture{pixels, width, height, numComponents});
+    SetTextureLayout(*texture, layout);
+    stbi_image_free(pixels);
+
+    return texture;
+}
+
+void SetTextureLayout(Texture& texture, TextureLayout layout)
+{
+    if (texture.Layout == layout)
+    {
+        return;
+    }
+
+    std::vector<unsigned char> storage =
+        ConvertTexels(texture.Data, texture.Layout, layout, texture.Width, texture.Height, texture.NumComponents);
+
+    for (MipLevel& mipLevel : texture.MipLevels)
+    {
+        mipLevel.Data = ConvertTexels(mipLevel.Data.data(), texture.Layout, layout, mipLevel.Width, mipLevel.Height,
+                                      texture.NumComponents);
+    }
+
+    // Moving the vector keeps its buffer where it is
+    texture.Storage = std::move(storage);
+    texture.Data    = texture.Storage.data();
+    texture.Layout  = layout;
+}
+
+size_t GetTextureMemorySize(const Texture& texture)
+{
+    size_t size = GetLevelSize(texture.Layout, texture.Width, texture.Height, texture.NumComponents);
+
+    for (const MipLevel& mipLevel : texture.MipLevels)
+    {
+        size += mipLevel.Data.size();
+    }
+
+    return size;
+}
+
+void BuildMipChain(Texture& texture)
+{
+    int numComponents = texture.NumComponents;
+
+    // Compressed texels can't be averaged as they are, so the chain is built from a decoded copy of the texture and
+    // then compressed level by level
+    if (texture.Layout == TextureLayout::Compressed)
+    {
+        std::vector<unsigned char> texels = ConvertTexels(texture.Data, TextureLayout::Compressed,
+                                                          TextureLayout::RowMajor, texture.Width, texture.Height,
+                                                          numComponents);
+
+        Texture decoded{texels.data(), texture.Width, texture.Height, numComponents};
+        BuildMipChain(decoded);
+
+        for (MipLevel& mipLevel : decoded.MipLevels)
+        {
+            mipLevel.Data = ConvertTexels(mipLevel.Data.data(), TextureLayout::RowMajor, TextureLayout::Compressed,
+                                          mipLevel.Width, mipLevel.Height, numComponents);
+        }
+
+        texture.MipLevels = std::move(decoded.MipLevels);
+        return;
+    }
+
+    int numLevels = 0;
+    for (int width = texture.Width, height = texture.Height; width > 1 || height > 1; numLevels++)
+    {
+        width  = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+
+    texture.MipLevels.clear();
+    texture.MipLevels.reserve(numLevels);
+
+    for (int level = 1; level <= numLevels; level++)
+    {
+        TextureLevel source = GetTextureLevel(texture, level - 1);
+
+        MipLevel mipLevel;
+        mipLevel.Width  = std::max(1, source.Width / 2);
+        mipLevel.Height = std::max(1, source.Height / 2);
+        mipLevel.Data.resize(GetLevelSize(source.Layout, mipLevel.Width, mipLevel.Height, numComponents));
+
+        for (int y = 0; y < mipLevel.Height; y++)
+        {
+            // A side that is already 1 texel long only gets halved along the other one. With an odd size, the last
+            // row or column of the level above is left out.
+            int y0 = y * 2;
+            int y1 = std::min(y * 2 + 1, source.Height - 1);
+
+            for (int x = 0; x < mipLevel.Width; x++)
+            {
+                int x0 = x * 2;
+                int x1 = std::min(x * 2 + 1, source.Width - 1);
+
+                const unsigned char* texels[4] = {
+                    source.Data + GetTexelIndex(source.Layout, source.Width, x0, y0) * numComponents,
+                    source.Data + GetTexelIndex(source.Layout, source.Width, x1, y0) * numComponents,
+                    source.Data + GetTexelIndex(source.Layout, source.Width, x0, y1) * numComponents,
+                    source.Data + GetTexelIndex(source.Layout, source.Width, x1, y1) * numComponents,
+                };
+                unsigned char* destination =
+                    mipLevel.Data.data() + GetTexelIndex(source.Layout, mipLevel.Width, x, y) * numComponents;
+
+                for (int component = 0; component < numComponents; component++)
+                {
+                    int sum = texels[0][component] + texels[1][component] + texels[2][component] + texels[3][component];
+                    destination[component] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+
+        texture.MipLevels.push_back(std::move(mipLevel));
+    }
+}
+
+float ComputeTextureLod(const Texture& texture, const glm::vec2& texCoordDx, const glm::vec2& texCoordDy)
+{
+    // The footprint in texels of the full resolution level, the larger of the two directions
+    glm::vec2 size(static_cast<float>(texture.Width), static_cast<float>(texture.Height));
+    glm::vec2 texelDx = texCoordDx * size;
+    glm::vec2 texelDy = texCoordDy * size;
+
+    float footprintSquared = std::max(glm::dot(texelDx, texelDx), glm::dot(texelDy, texelDy));
+
+    // log2 of the footprint, without the square root. A footprint of a texel or less is magnified instead, on the
+    // full resolution level, and so is a degenerate one.
+    float lod = 0.5f * std::log2(footprintSquared);
+    if (!(lod > 0.0f))
+    {
+        return 0.0f;
+    }
+
+    return std::min(lod, static_cast<float>(texture.MipLevels.size()));
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// How the texels of a texture are laid out in memory
+enum class TextureLayout
+{
+    // One row after the other, the way images are decoded. Texels next to each other vertically are a whole row
+    // apart, so a pixel footprint that moves across rows touches a different cache line for every texel.
+    RowMajor,
+    // Square tiles of TEXTURE_TILE_SIZE texels on a side, one row of tiles after the other, with the texels of a tile
+    // stored together row by row. The texels around any point are then at most four tiles, a few cache lines, away
+    // whichever direction the footprint moves in. Levels whose size is not a multiple of the tile size are padded.
+    Tiled,
+    // The same tiles, each compressed on its own to a fixed number of bytes the way BC1 and BC4 block compression do,
+    // see GetCompressedBlockSize. The colors of a tile are reduced to points on a line between two endpoints, which
+    // takes 6 times less memory for RGB textures and 4 times less for RGBA ones, at the cost of some color precision.
+    // The sampler decodes the blocks as it reads them, which costs more work per texel but far less memory traffic.
+    Compressed,
+};
+
+const unsigned int TEXTURE_TILE_SIZE = 4;
+
+// A level of a mip chain, with the same number of components per texel and the same layout as its texture
+struct MipLevel
+{
+    std::vector<unsigned char> Data;
+    int                        Width;
+    int                        Height;
+};
+
+struct Texture
+{
+    unsigned char* Data;
+    int            Width;
+    int            Height;
+    int            NumComponents;
+
+    // The levels below the full resolution one in Data, each half the size of the one before, down to 1x1. Empty
+    // unless BuildMipChain has been called on the texture.
+    std::vector<MipLevel> MipLevels = {};
+
+    TextureLayout Layout = TextureLayout::RowMajor;
+
+    // Holds the texels Data points to once they have been laid out again, empty while Data is still the decoded image
+    std::vector<unsigned char> Storage = {};
+};
+
+// The texels of one level of a texture, 0 being the full resolution one
+struct TextureLevel
+{
+    const unsigned char* Data;
+    int                  Width;
+    int                  Height;
+    TextureLayout        Layout;
+};
+
+inline TextureLevel GetTextureLevel(const Texture& texture, int level)
+{
+    if (level == 0)
+    {
+        return {texture.Data, texture.Width, texture.Height, texture.Layout};
+    }
+
+    const MipLevel& mipLevel = texture.MipLevels[level - 1];
+    return {mipLevel.Data.data(), mipLevel.Width, mipLevel.Height, texture.Layout};
+}
+
+// The index of the texel at (x, y) in a level that is width texels wide, to be multiplied by the number of components.
+// Compressed levels have no index per texel, see GetBlockOffset instead.
+inline size_t GetTexelIndex(TextureLayout layout, int width, int x, int y)
+{
+    if (layout == TextureLayout::RowMajor)
+    {
+        return x + static_cast<size_t>(y) * width;
+    }
+
+    // Unsigned, so that the divisions by the tile size are plain shifts and masks
+    unsigned int column = static_cast<unsigned int>(x);
+    unsigned int row    = static_cast<unsigned int>(y);
+
+    size_t tilesPerRow = (static_cast<unsigned int>(width) + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+    size_t tile        = column / TEXTURE_TILE_SIZE + row / TEXTURE_TILE_SIZE * tilesPerRow;
+
+    return tile * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE + row % TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE +
+           column % TEXTURE_TILE_SIZE;
+}
+
+// The number of bytes a compressed tile takes. The colors of RGB and RGBA textures are compressed together into 8
+// bytes, like BC1 does, and grayscale textures into 8 bytes as well, like BC4 does. Alpha gets 8 more bytes, again
+// like BC4 does, for 4 times less memory than the 64 bytes of an uncompressed RGBA tile.
+inline size_t GetCompressedBlockSize(int numComponents)
+{
+    return numComponents == 1 || numComponents == 3 ? 8 : 16;
+}
+
+// The offset of the compressed tile that holds the texel at (x, y), in a compressed level that is width texels wide
+inline size_t GetBlockOffset(int width, int numComponents, int x, int y)
+{
+    unsigned int column = static_cast<unsigned int>(x);
+    unsigned int row    = static_cast<unsigned int>(y);
+
+    size_t tilesPerRow = (static_cast<unsigned int>(width) + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+    size_t tile        = column / TEXTURE_TILE_SIZE + row / TEXTURE_TILE_SIZE * tilesPerRow;
+
+    return tile * GetCompressedBlockSize(numComponents);
+}
+
+// The number of bytes a level takes in memory, padding included
+inline size_t GetLevelSize(TextureLayout layout, int width, int height, int numComponents)
+{
+    if (layout == TextureLayout::RowMajor)
+    {
+        return static_cast<size_t>(width) * height * numComponents;
+    }
+
+    size_t tilesPerRow    = (width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+    size_t tilesPerColumn = (height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+
+    if (layout == TextureLayout::Compressed)
+    {
+        return tilesPerRow * tilesPerColumn * GetCompressedBlockSize(numComponents);
+    }
+
+    return tilesPerRow * tilesPerColumn * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE * numComponents;
+}
+
+// Decodes a compressed tile into its texels, row by row, with the number of components of its texture each. Texels
+// holds TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE of them.
+void DecodeTextureBlock(const unsigned char* block, int numComponents, unsigned char* texels);
+
+// Decodes an image file into a texture, flipped vertically so that its first row is the bottom one, the same as the
+// images the renderer writes. The pixels are freed along with the last reference to the texture. Returns nullptr if
+// the file can't be read. Can be called from several threads at once.
+//
+// The texels are laid out the given way, which for anything but RowMajor takes a copy of the image before freeing it.
+std::shared_ptr<Texture> DecodeTexture(const std::string& filename, TextureLayout layout = TextureLayout::RowMajor);
+
+// Lays the texels of the texture, and of its mip chain if it has one, out again in the given layout. The texture then
+// owns its texels in Storage, and must not be copied since Data points into it. Whatever Data pointed to before is
+// left alone.
+void SetTextureLayout(Texture& texture, TextureLayout layout);
+
+// The memory taken by the texels of the texture and its mip chain, padding included
+size_t GetTextureMemorySize(const Texture& texture);
+
+// Builds the mip chain of the texture, every texel of a level being the average of the 2x2 texels it covers in the
+// level above. Takes another third of the memory of the texture. The levels of a compressed texture are built from
+// its decoded texels, and compressed in turn.
+//
+// A surface that covers only a few pixels on screen can then be sampled from a level about as small as it is. That
+// reads far fewer texels, which also stay in the cache, and averages the texels in between instead of skipping them.
+void BuildMipChain(Texture& texture);
+
+// The mip level that matches the footprint of a pixel on the texture, given how much the texture coordinates change
+// from the pixel to its right and upper neighbours. 0 is the full resolution, and every level above halves it. Can be
+// fractional, and is clamped to the levels the texture has.
+float ComputeTextureLod(const Texture& texture, const glm::vec2& texCoordDx, const glm::vec2& texCoordDy);
@@ -0,0 +1,134 @@
+#include "texturecache.h"
+
+#include "Utilities/threadpool.h"
+
+TextureCache::TextureCache(ThreadPool& threadPool, size_t memoryBudget, TextureLayout textureLayout)
+    : m_ThreadPool(threadPool), m_MemoryBudget(memoryBudget), m_TextureLayout(textureLayout)
+{
+}
+
+TextureCache::~TextureCache()
+{
+    // The loading tasks call back into the cache
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_LoadingDone.wait(lock, [this] { return m_NumLoading == 0; });
+}
+
+AssetHandle<Texture> TextureCache::Load(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto found = m_Entries.find(filename);
+    if (found != m_Entries.end())
+    {
+        m_Stats.Hits++;
+
+        // Move it to the front of the list
+        m_Lru.splice(m_Lru.begin(), m_Lru, found->second.LruPosition);
+        return found->second.Handle;
+    }
+
+    m_Stats.Misses++;
+    m_Stats.NumTextures++;
+
+    // Decoded like AssetLoader::LoadTexture does, and then reported back to the cache, so that it learns what the
+    // texture takes exactly once
+    std::uint64_t id = m_NextId++;
+    m_NumLoading++;
+
+    auto loadTexture = [this, filename, id, layout = m_TextureLayout]() {
+        std::shared_ptr<Texture> texture;
+        try
+        {
+            texture = DecodeTexture(filename, layout);
+            if (texture != nullptr)
+            {
+                BuildMipChain(*texture);
+            }
+        }
+        catch (...)
+        {
+            // Still reported, or the destructor would wait for it forever. The exception goes on to the handle.
+            OnLoaded(filename, id, 0);
+            throw;
+        }
+
+        // Missing files still take up an entry, counted as a single byte
+        OnLoaded(filename, id, texture != nullptr ? GetTextureMemorySize(*texture) : 1);
+        return texture;
+    };
+
+    AssetHandle<Texture> texture = m_ThreadPool.Submit(loadTexture).share();
+
+    m_Lru.push_front(filename);
+    m_Entries.emplace(filename, Entry{texture, id, 0, m_Lru.begin()});
+
+    return texture;
+}
+
+void TextureCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_Entries.clear();
+    m_Lru.clear();
+    m_Stats = {};
+}
+
+TextureCacheStats TextureCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+void TextureCache::OnLoaded(const std::string& filename, std::uint64_t id, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // The entry is gone, or is a newer one for the same file, if the cache was cleared in the meantime
+    auto found = m_Entries.find(filename);
+    if (found != m_Entries.end() && found->second.Id == id && size == 0)
+    {
+        // The next request tries again rather than getting the exception as well
+        m_Stats.NumTextures--;
+        m_Lru.erase(found->second.LruPosition);
+        m_Entries.erase(found);
+    }
+    else if (found != m_Entries.end() && found->second.Id == id)
+    {
+        found->second.Size = size;
+        m_Stats.MemoryUsed += size;
+
+        EnforceBudget(filename);
+    }
+
+    // Notified with the lock held, since the destructor may return as soon as it sees the count drop
+    m_NumLoading--;
+    m_LoadingDone.notify_all();
+}
+
+void TextureCache::EnforceBudget(const std::string& keep)
+{
+    // From the least recently used one
+    auto candidate = m_Lru.end();
+    while (m_Stats.MemoryUsed > m_MemoryBudget && candidate != m_Lru.begin())
+    {
+        --candidate;
+
+        auto found = m_Entries.find(*candidate);
+
+        // The texture that just finished loading stays, since whoever asked for it is about to use it, and so do the
+        // ones still loading since what they take isn't known yet
+        if (*candidate == keep || found->second.Size == 0)
+        {
+            continue;
+        }
+
+        m_Stats.MemoryUsed -= found->second.Size;
+        m_Stats.NumTextures--;
+        m_Stats.Evictions++;
+
+        m_Entries.erase(found);
+        candidate = m_Lru.erase(candidate);
+    }
+}
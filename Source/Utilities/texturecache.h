@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Utilities/assetloader.h"
+#include "Utilities/texture.h"
+
+class ThreadPool;
+
+struct TextureCacheStats
+{
+    // Requests for a texture the cache already had, whether or not it had finished loading
+    size_t Hits;
+    // Requests that had to load the texture
+    size_t Misses;
+    // Textures dropped to stay within the memory budget
+    size_t Evictions;
+    // The textures the cache holds, and the memory taken by the ones that have finished loading
+    size_t NumTextures;
+    size_t MemoryUsed;
+};
+
+// Loads every texture file once, and hands out the same handle to everyone who asks for it again, for as long as it
+// stays in the cache. Renders that go through the same textures over and over only pay for decoding them the first
+// time.
+//
+// The cache holds on to the textures it loaded until they take more than the memory budget together, at which point
+// the ones that were asked for the longest time ago are dropped. A dropped texture stays alive for as long as someone
+// still has a handle to it, and is loaded again the next time it is asked for. What a texture takes is only known once
+// it has finished loading, so textures count towards the budget from then on, and the budget is checked whenever one
+// finishes. The textures still loading count as nothing and are never dropped, so the cache can go over the budget by
+// as much as they take. With the Compressed layout the same budget holds 4 to 6 times as many color textures.
+//
+// Can be used from several threads at once. The cache only keeps a reference to the pool, which has to outlive the
+// loading, and waits for the textures it is still loading when it goes away.
+class TextureCache
+{
+
+  public:
+    TextureCache(ThreadPool& threadPool, size_t memoryBudget, TextureLayout textureLayout = TextureLayout::RowMajor);
+    ~TextureCache();
+
+    // The texture in the file, decoded with its mip chain like AssetLoader::LoadTexture does. Files that can't be read
+    // are remembered as well, and their handles hold nullptr.
+    AssetHandle<Texture> Load(const std::string& filename);
+
+    // Drops every texture and starts the stats over. Textures still loading finish loading for whoever has their
+    // handles, without being added back to the cache.
+    void Clear();
+
+    TextureCacheStats GetStats() const;
+
+  private:
+    struct Entry
+    {
+        AssetHandle<Texture>             Handle;
+        // Tells apart the entries a file gets after being dropped and loaded again
+        std::uint64_t                    Id;
+        // 0 until the texture has finished loading
+        size_t                           Size;
+        std::list<std::string>::iterator LruPosition;
+    };
+
+    // Called by the loading task of the entry with the id once the texture is ready, with what it takes, or with a size
+    // of 0 if loading it threw, which drops the entry
+    void OnLoaded(const std::string& filename, std::uint64_t id, size_t size);
+
+    // Drops the least recently used textures that have finished loading, other than keep, until the rest fit in the
+    // budget
+    void EnforceBudget(const std::string& keep);
+
+    ThreadPool&   m_ThreadPool;
+    size_t        m_MemoryBudget;
+    TextureLayout m_TextureLayout;
+
+    mutable std::mutex                     m_Mutex;
+    std::unordered_map<std::string, Entry> m_Entries;
+    // The filenames of the entries, the most recently used first
+    std::list<std::string> m_Lru;
+    TextureCacheStats      m_Stats  = {};
+    std::uint64_t          m_NextId = 0;
+
+    // The loading tasks that haven't called OnLoaded yet, which the destructor waits for
+    size_t                  m_NumLoading = 0;
+    std::condition_variable m_LoadingDone;
+};
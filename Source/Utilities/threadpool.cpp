@@ -0,0 +1,114 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int numThreads) : m_Workers(), m_Tasks(), m_Stopping(false)
+{
+    // hardware_concurrency is allowed to return 0 when it cannot tell
+    if (numThreads == 0)
+    {
+        numThreads = 1;
+    }
+
+    for (unsigned int i = 0; i < numThreads; i++)
+    {
+        m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Condition.notify_all();
+
+    for (std::thread& worker : m_Workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.push(std::move(task));
+    }
+    m_Condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+
+            // Finish whatever is still queued before shutting down
+            if (m_Stopping && m_Tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop();
+        }
+
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& body)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // The state is shared with the helper tasks, which may only get picked up after the loop is already done
+    struct LoopState
+    {
+        std::atomic<int>        NextIndex{0};
+        std::atomic<int>        NumCompleted{0};
+        std::mutex              Mutex;
+        std::condition_variable Done;
+    };
+
+    std::shared_ptr<LoopState> state = std::make_shared<LoopState>();
+
+    // Every participant keeps grabbing the next unclaimed index until there are none left. This balances the load
+    // when some indices are much more expensive than others (e.g. tiles covered by many triangles).
+    auto runIndices = [state, count, &body]() {
+        int index;
+        while ((index = state->NextIndex.fetch_add(1)) < count)
+        {
+            body(index);
+
+            if (state->NumCompleted.fetch_add(1) + 1 == count)
+            {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                state->Done.notify_all();
+            }
+        }
+    };
+
+    int numHelpers = std::min(count, static_cast<int>(m_Workers.size())) - 1;
+    for (int i = 0; i < numHelpers; i++)
+    {
+        // Helpers that start after all indices are claimed return straight away without touching body, so it is fine
+        // for body to go out of scope once every index has completed
+        Enqueue(runIndices);
+    }
+
+    runIndices();
+
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    state->Done.wait(lock, [&state, count] { return state->NumCompleted.load() == count; });
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+
+  public:
+    ThreadPool(unsigned int numThreads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    // Calls body(i) for every i in [0, count), spreading the indices over the workers. The calling thread takes part
+    // in the work as well, so it is safe to call this from inside a task that is itself running on the pool.
+    void ParallelFor(int count, const std::function<void(int)>& body);
+
+    // Runs task on one of the workers and returns a future for its result, for work that should go on in the
+    // background while the caller does something else. A task can use ParallelFor, but should not wait on the future
+    // of another task, since that one may be queued behind it with no free worker left to run it.
+    template <typename Task>
+    std::future<std::invoke_result_t<Task>> Submit(Task task)
+    {
+        using Result = std::invoke_result_t<Task>;
+
+        // std::function needs something copyable, which a packaged_task is not
+        auto                packagedTask = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> future       = packagedTask->get_future();
+
+        Enqueue([packagedTask]() { (*packagedTask)(); });
+
+        return future;
+    }
+
+    inline unsigned int GetNumThreads() const { return static_cast<unsigned int>(m_Workers.size()); }
+
+  private:
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+
+    std::vector<std::thread>          m_Workers;
+    std::queue<std::function<void()>> m_Tasks;
+    std::mutex                        m_Mutex;
+    std::condition_variable           m_Condition;
+    bool                              m_Stopping;
+};
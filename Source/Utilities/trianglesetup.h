@@ -0,0 +1,214 @@
+#pragma once
+
+// Helpers shared by the rasterizer backends that work from integer triangle setup. This is an internal header, only
+// meant to be included by the rasterizer source files.
+
+#include "glm/geometric.hpp"
+#include "glm/glm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "Utilities/rasterizer.h"
+
+// Vertices are snapped to a grid of 1 / SUBPIXEL_STEPS of a pixel before rasterization, giving 28.4 fixed point
+// screen coordinates. Pixels are sampled at their integer coordinates, which are multiples of SUBPIXEL_STEPS there.
+const int SUBPIXEL_BITS  = 4;
+const int SUBPIXEL_STEPS = 1 << SUBPIXEL_BITS;
+
+// Rounds a screen coordinate to the nearest point of the sub-pixel grid
+inline int SnapToSubpixel(float coordinate)
+{
+    return static_cast<int>(std::lround(coordinate * SUBPIXEL_STEPS));
+}
+
+// An edge function E(p) = StepX * p.x + StepY * p.y + Offset, in integer form so it can be stepped exactly. It is set
+// up from fixed point vertices, but evaluated at whole pixels, so the steps are the change from one pixel to the next.
+struct EdgeEquation
+{
+    int64_t StepX;
+    int64_t StepY;
+    int64_t Offset;
+
+    EdgeEquation() = default;
+    EdgeEquation(const glm::ivec2& a, const glm::ivec2& b)
+    {
+        // Expanding EdgeFunctionCCW(a, b, p) = (a.x - b.x) * (p.y - a.y) - (a.y - b.y) * (p.x - a.x), with p in fixed
+        // point, p = pixel * SUBPIXEL_STEPS
+        int64_t deltaX = static_cast<int64_t>(a.x) - b.x;
+        int64_t deltaY = static_cast<int64_t>(b.y) - a.y;
+
+        StepX  = deltaY * SUBPIXEL_STEPS;
+        StepY  = deltaX * SUBPIXEL_STEPS;
+        Offset = -(deltaY * a.x + deltaX * a.y);
+    }
+
+    inline int64_t Evaluate(int x, int y) const { return StepX * x + StepY * y + Offset; }
+
+    // Inside a triangle, every edge function is negative. With the top-left fill rule, pixels exactly on an edge (where
+    // it is 0) only belong to the triangle if that is one of its top or left edges. The triangle on the other side of
+    // the edge sees it as a bottom or right edge, so a pixel on an edge shared by two triangles is drawn exactly once.
+    //
+    // Only valid once the triangle has been made counter clockwise (in y up screen space), where the inside is on the
+    // left of each edge: left edges go down, top edges are horizontal and go towards -x.
+    inline bool IsTopLeft() const { return StepX < 0 || (StepX == 0 && StepY > 0); }
+};
+
+// The light intensity and texture coordinates of a pixel that has passed both the coverage and the depth test, given
+// its barycentric coordinates. Returns false if the pixel is not lit, in which case nothing should be drawn.
+inline bool LightFragment(const Triangle& triangle, const ShadingState& shading, float w0, float w1, float w2,
+                          float& lightIntensity, glm::vec2& texCoord)
+{
+    const glm::vec3* normals = triangle.Normals;
+    const glm::vec2* uvs     = triangle.TexCoords;
+
+    glm::vec3 normal = glm::normalize(normals[0] * w0 + normals[1] * w1 + normals[2] * w2);
+    lightIntensity   = glm::dot(shading.LightDirection, normal);
+
+    // If fragment is not illuminated, then don't draw it
+    if (lightIntensity <= 0)
+    {
+        return false;
+    }
+
+    texCoord = uvs[0] * w0 + uvs[1] * w1 + uvs[2] * w2;
+    return true;
+}
+
+// Shades a pixel that has passed both the coverage and the depth test, given its barycentric coordinates. Returns
+// false if the pixel is not lit, in which case nothing should be drawn. The level of detail of the texture is only
+// known when the pixel is shaded along with its neighbours, and is only used by trilinear filtering.
+inline bool ShadeFragment(const Triangle& triangle, const ShadingState& shading, float w0, float w1, float w2,
+                          TGAColor& color, float textureLod = 0.0f)
+{
+    float     lightIntensity;
+    glm::vec2 texCoord;
+    if (!LightFragment(triangle, shading, w0, w1, w2, lightIntensity, texCoord))
+    {
+        return false;
+    }
+
+    color = SampleTexture(*shading.DiffuseTexture, shading.Sampler, texCoord, textureLod) * lightIntensity;
+    return true;
+}
+
+// The value of the edge function of b and c at a, for fixed point vertices. This is twice the area of the triangle,
+// negative when it is counter clockwise in y up screen space and positive when it is clockwise.
+inline int64_t GetSignedArea(const glm::ivec2& a, const glm::ivec2& b, const glm::ivec2& c)
+{
+    return (static_cast<int64_t>(c.y) - b.y) * (a.x - b.x) + (static_cast<int64_t>(b.x) - c.x) * (a.y - b.y);
+}
+
+// How far the depth interpolated by the backends can stray outside the range of the vertex depths, given the fixed
+// point area of the triangle. The top-left fill rule pushes up to three edge functions up by one, so the weights inside
+// the triangle add up to as little as 1 - 3 / |area| instead of 1, which scales the depth towards 0 by as much. The
+// rest covers the rounding of interpolating in floating point. Degenerate triangles get an infinite error.
+inline float GetDepthError(const glm::vec3 vertices[3], int64_t area)
+{
+    if (area == 0)
+    {
+        return std::numeric_limits<float>::infinity();
+    }
+
+    float largestDepth = std::max({std::abs(vertices[0].z), std::abs(vertices[1].z), std::abs(vertices[2].z)});
+    return largestDepth * (3.0f / std::abs(static_cast<float>(area)) + 1e-5f);
+}
+
+// Computes the bounding box of the pixels the triangle can cover, given its fixed point vertices, clamped to clipRect.
+// Returns false if it is empty.
+inline bool GetClampedBoundingBox(const glm::ivec2 vertices[3], const PixelRect& clipRect, PixelRect& bbox)
+{
+    int minX = std::min({vertices[0].x, vertices[1].x, vertices[2].x});
+    int minY = std::min({vertices[0].y, vertices[1].y, vertices[2].y});
+    int maxX = std::max({vertices[0].x, vertices[1].x, vertices[2].x});
+    int maxY = std::max({vertices[0].y, vertices[1].y, vertices[2].y});
+
+    // The first and last pixel inside the bounds, rounding up and down to whole pixels
+    bbox.MinX = std::max(clipRect.MinX, (minX + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS);
+    bbox.MinY = std::max(clipRect.MinY, (minY + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS);
+    bbox.MaxX = std::min(clipRect.MaxX, maxX >> SUBPIXEL_BITS);
+    bbox.MaxY = std::min(clipRect.MaxY, maxY >> SUBPIXEL_BITS);
+
+    return bbox.MinX <= bbox.MaxX && bbox.MinY <= bbox.MaxY;
+}
+
+// Everything the integer rasterizers need to know about a triangle before walking its pixels
+struct TriangleSetup
+{
+    EdgeEquation Edges[3];
+    PixelRect    BoundingBox;
+    float        InverseArea;
+
+    // The vertex depths, premultiplied by InverseArea so that they can be weighted by the raw edge function values
+    float Z[3];
+
+    // How far an interpolated depth can be outside the range of the vertex depths, see GetDepthError
+    float DepthError;
+};
+
+// Sets up the edge equations of the triangle. Returns false if the triangle does not cover any pixel of clipRect.
+inline bool SetupTriangle(const Triangle& triangle, const PixelRect& clipRect, TriangleSetup& setup)
+{
+    const glm::vec3* vertices = triangle.ScreenCoords;
+
+    glm::ivec2 points[3];
+    for (int i = 0; i < 3; i++)
+    {
+        points[i] = glm::ivec2(SnapToSubpixel(vertices[i].x), SnapToSubpixel(vertices[i].y));
+    }
+
+    // for each weight, the edge opposite to its vertex
+    setup.Edges[0] = EdgeEquation(points[1], points[2]);
+    setup.Edges[1] = EdgeEquation(points[2], points[0]);
+    setup.Edges[2] = EdgeEquation(points[0], points[1]);
+
+    // The three edge functions always add up to the area, so a pixel can only have all of them <= 0 (and be inside)
+    // when the area is negative. Degenerate triangles never cover any pixel.
+    int64_t area = GetSignedArea(points[0], points[1], points[2]);
+    if (area == 0)
+    {
+        return false;
+    }
+
+    // Triangles wound the other way are turned around by flipping the sign of every edge function. The weights, which
+    // are the edge functions divided by the area, stay the same. Culling is left to the culling stage.
+    if (area > 0)
+    {
+        for (EdgeEquation& edge : setup.Edges)
+        {
+            edge.StepX  = -edge.StepX;
+            edge.StepY  = -edge.StepY;
+            edge.Offset = -edge.Offset;
+        }
+        area = -area;
+    }
+
+    // The backends all test for <= 0, so pushing the edges that are not top-left up by one makes pixels exactly on
+    // them fail, while leaving every other pixel where it was since the edge functions only take integer values. This
+    // skews the barycentric weights by at most 1 / area, far below anything visible.
+    for (EdgeEquation& edge : setup.Edges)
+    {
+        if (!edge.IsTopLeft())
+        {
+            edge.Offset += 1;
+        }
+    }
+
+    if (!GetClampedBoundingBox(points, clipRect, setup.BoundingBox))
+    {
+        return false;
+    }
+
+    setup.InverseArea = 1.0f / static_cast<float>(area);
+    setup.DepthError  = GetDepthError(vertices, area);
+
+    // Depth is interpolated with the same weights, so fold the division by the area into the vertex depths
+    for (int i = 0; i < 3; i++)
+    {
+        setup.Z[i] = vertices[i].z * setup.InverseArea;
+    }
+
+    return true;
+}
@@ -0,0 +1,193 @@
+#include "vertexprocessing.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "Utilities/cpufeatures.h"
+
+#if RENDERER_X86
+#include <immintrin.h>
+#endif
+
+// The number of vertices or faces every task of the pool works through at once
+const int VERTEX_CHUNK_SIZE = 4096;
+
+static void TransformRange(const Vertex* vertices, int count, const glm::mat4& matrix, glm::vec4* clipPositions)
+{
+#if RENDERER_X86
+    // SSE2 is part of x86-64, so this needs no check. A position is a combination of the columns of the matrix, which
+    // is four multiplies and three adds of whole columns. The additions are done in the same order as glm does them.
+    __m128 column0 = _mm_loadu_ps(&matrix[0][0]);
+    __m128 column1 = _mm_loadu_ps(&matrix[1][0]);
+    __m128 column2 = _mm_loadu_ps(&matrix[2][0]);
+    __m128 column3 = _mm_loadu_ps(&matrix[3][0]);
+
+    for (int i = 0; i < count; i++)
+    {
+        const glm::vec3& position = vertices[i].Position;
+
+        __m128 xy = _mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(position.x)),
+                               _mm_mul_ps(column1, _mm_set1_ps(position.y)));
+        __m128 zw = _mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(position.z)), column3);
+
+        _mm_storeu_ps(&clipPositions[i].x, _mm_add_ps(xy, zw));
+    }
+#else
+    for (int i = 0; i < count; i++)
+    {
+        clipPositions[i] = matrix * glm::vec4(vertices[i].Position, 1.0f);
+    }
+#endif
+}
+
+void TransformVertices(Span<const Vertex> vertices, const glm::mat4& matrix, std::vector<glm::vec4>& clipPositions,
+                       ThreadPool& threadPool)
+{
+    int numVertices = static_cast<int>(vertices.size());
+    int numChunks   = (numVertices + VERTEX_CHUNK_SIZE - 1) / VERTEX_CHUNK_SIZE;
+
+    clipPositions.resize(vertices.size());
+
+    threadPool.ParallelFor(numChunks, [&](int chunk) {
+        int first = chunk * VERTEX_CHUNK_SIZE;
+        int count = std::min(VERTEX_CHUNK_SIZE, numVertices - first);
+
+        TransformRange(vertices.data() + first, count, matrix, clipPositions.data() + first);
+    });
+}
+
+// Fetches the attributes of a welded vertex, from either of the layouts of the model
+struct AoSVertexFetch
+{
+    Span<const Vertex> Vertices;
+
+    inline void Fetch(std::uint32_t index, ClipVertex& vertex) const
+    {
+        vertex.TexCoord = Vertices[index].TexCoord;
+        vertex.Normal   = Vertices[index].Normal;
+    }
+};
+
+struct SoAVertexFetch
+{
+    const SoAVertexBuffer& Vertices;
+
+    inline void Fetch(std::uint32_t index, ClipVertex& vertex) const
+    {
+        vertex.TexCoord = glm::vec2(Vertices.TexCoordU[index], Vertices.TexCoordV[index]);
+        vertex.Normal   = glm::vec3(Vertices.NormalX[index], Vertices.NormalY[index], Vertices.NormalZ[index]);
+    }
+};
+
+// Templated on the index type, so that the choice between 16 and 32 bit indices is made once and not per corner
+template <typename IndexType, typename VertexFetch>
+static void AssembleTriangles(Span<const IndexType> indices, const VertexFetch& fetch,
+                              const std::vector<glm::vec4>& clipPositions, std::vector<ClipTriangle>& triangles,
+                              ThreadPool& threadPool)
+{
+    int numFaces  = static_cast<int>(indices.size() / 3);
+    int numChunks = (numFaces + VERTEX_CHUNK_SIZE - 1) / VERTEX_CHUNK_SIZE;
+
+    triangles.resize(numFaces);
+
+    threadPool.ParallelFor(numChunks, [&](int chunk) {
+        int first = chunk * VERTEX_CHUNK_SIZE;
+        int last  = std::min(first + VERTEX_CHUNK_SIZE, numFaces);
+
+        for (int i = first; i < last; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                ClipVertex&   vertex = triangles[i].Vertices[j];
+                std::uint32_t index  = indices[i * 3 + j];
+
+                vertex.Position = clipPositions[index];
+                fetch.Fetch(index, vertex);
+            }
+        }
+    });
+}
+
+template <typename VertexFetch>
+static void AssembleTriangles(const IndexBuffer& indices, const VertexFetch& fetch,
+                              const std::vector<glm::vec4>& clipPositions, std::vector<ClipTriangle>& triangles,
+                              ThreadPool& threadPool)
+{
+    if (indices.Is16Bit())
+    {
+        AssembleTriangles(indices.GetIndices16(), fetch, clipPositions, triangles, threadPool);
+    }
+    else
+    {
+        AssembleTriangles(indices.GetIndices32(), fetch, clipPositions, triangles, threadPool);
+    }
+}
+
+void AssembleTriangles(const Model& model, const std::vector<glm::vec4>& clipPositions,
+                       std::vector<ClipTriangle>& triangles, ThreadPool& threadPool)
+{
+    AssembleTriangles(model.GetIndices(), AoSVertexFetch{model.GetWeldedVertices()}, clipPositions, triangles,
+                      threadPool);
+}
+
+static void TransformRangeSoA(const SoAVertexBuffer& vertices, int first, int count, const glm::mat4& matrix,
+                              glm::vec4* clipPositions)
+{
+#if RENDERER_X86
+    // The count is always a multiple of 4 thanks to the padding of the arrays
+    for (int i = first; i < first + count; i += 4)
+    {
+        __m128 x = _mm_load_ps(&vertices.PositionX[i]);
+        __m128 y = _mm_load_ps(&vertices.PositionY[i]);
+        __m128 z = _mm_load_ps(&vertices.PositionZ[i]);
+
+        // One component of the output for all four vertices at once, adding in the same order as glm
+        __m128 rows[4];
+        for (int row = 0; row < 4; row++)
+        {
+            __m128 xy = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(matrix[0][row])),
+                                   _mm_mul_ps(y, _mm_set1_ps(matrix[1][row])));
+            __m128 zw = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(matrix[2][row])), _mm_set1_ps(matrix[3][row]));
+
+            rows[row] = _mm_add_ps(xy, zw);
+        }
+
+        // From one register per component to one register per vertex
+        _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+
+        for (int lane = 0; lane < 4; lane++)
+        {
+            _mm_storeu_ps(&clipPositions[i + lane].x, rows[lane]);
+        }
+    }
+#else
+    for (int i = first; i < first + count; i++)
+    {
+        glm::vec4 position(vertices.PositionX[i], vertices.PositionY[i], vertices.PositionZ[i], 1.0f);
+        clipPositions[i] = matrix * position;
+    }
+#endif
+}
+
+void TransformVerticesSoA(const SoAVertexBuffer& vertices, const glm::mat4& matrix,
+                          std::vector<glm::vec4>& clipPositions, ThreadPool& threadPool)
+{
+    int numVertices = static_cast<int>(vertices.PositionX.size());
+    int numChunks   = (numVertices + VERTEX_CHUNK_SIZE - 1) / VERTEX_CHUNK_SIZE;
+
+    clipPositions.resize(vertices.PositionX.size());
+
+    threadPool.ParallelFor(numChunks, [&](int chunk) {
+        int first = chunk * VERTEX_CHUNK_SIZE;
+        int count = std::min(VERTEX_CHUNK_SIZE, numVertices - first);
+
+        TransformRangeSoA(vertices, first, count, matrix, clipPositions.data());
+    });
+}
+
+void AssembleTrianglesSoA(const Model& model, const std::vector<glm::vec4>& clipPositions,
+                          std::vector<ClipTriangle>& triangles, ThreadPool& threadPool)
+{
+    AssembleTriangles(model.GetIndices(), SoAVertexFetch{model.GetSoAVertices()}, clipPositions, triangles,
+                      threadPool);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <vector>
+
+#include "Utilities/clipping.h"
+#include "Utilities/model.h"
+#include "Utilities/threadpool.h"
+
+// The front end of the pipeline works on indexed meshes the same way a GPU does: every vertex of the model is
+// transformed exactly once, no matter how many faces share it, and the triangles are then assembled by looking the
+// transformed vertices up by index. The transformed array acts as a post-transform cache holding every vertex.
+
+// Transforms the position of every welded vertex by the matrix into clip space. The vertices are split into chunks
+// spread over the pool, and each position is transformed with SIMD instructions where available.
+void TransformVertices(Span<const Vertex> vertices, const glm::mat4& matrix, std::vector<glm::vec4>& clipPositions,
+                       ThreadPool& threadPool);
+
+// Builds the clip space triangles of every face of the model from its index buffer, reading the positions from the
+// output of TransformVertices and the other attributes from the welded vertices
+void AssembleTriangles(const Model& model, const std::vector<glm::vec4>& clipPositions,
+                       std::vector<ClipTriangle>& triangles, ThreadPool& threadPool);
+
+// Same as TransformVertices, for the SoA layout of the model, which has to have been built. Transforms four vertices
+// at a time, one per SIMD lane, with every row of the matrix applied to whole registers of x, y and z components.
+// clipPositions ends up with one entry per vertex of the padded arrays, the ones past NumVertices are meaningless.
+void TransformVerticesSoA(const SoAVertexBuffer& vertices, const glm::mat4& matrix,
+                          std::vector<glm::vec4>& clipPositions, ThreadPool& threadPool);
+
+// Same as AssembleTriangles, reading the attributes from the SoA layout of the model
+void AssembleTrianglesSoA(const Model& model, const std::vector<glm::vec4>& clipPositions,
+                          std::vector<ClipTriangle>& triangles, ThreadPool& threadPool);
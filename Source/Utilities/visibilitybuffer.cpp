@@ -0,0 +1,255 @@
+#include "visibilitybuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Utilities/rasterizer.h"
+#include "Utilities/trianglesetup.h"
+
+VisibilityBuffer::VisibilityBuffer(int width, int height)
+    : m_Width(width), m_Height(height), m_PrimitiveIds(static_cast<size_t>(width) * height, EMPTY),
+      m_Barycentrics(static_cast<size_t>(width) * height * 2)
+{
+}
+
+void VisibilityBuffer::Clear()
+{
+    std::fill(m_PrimitiveIds.begin(), m_PrimitiveIds.end(), EMPTY);
+}
+
+void VisibilityBuffer::GetBarycentrics(size_t pixelIndex, float& w0, float& w1, float& w2) const
+{
+    w1 = m_Barycentrics[pixelIndex * 2] * (1.0f / 65535.0f);
+    w2 = m_Barycentrics[pixelIndex * 2 + 1] * (1.0f / 65535.0f);
+    w0 = 1.0f - w1 - w2;
+
+    // Rounding w1 and w2 can push their sum just past 1 on the edge opposite the first vertex, which would extrapolate
+    // the attributes, so they get scaled back onto the edge
+    if (w0 < 0.0f)
+    {
+        float scale = 1.0f / (w1 + w2);
+        w1 *= scale;
+        w2 *= scale;
+        w0  = 0.0f;
+    }
+}
+
+// The texture coordinates the triangle has at the pixel, extending it past its edges for pixels it doesn't cover
+static glm::vec2 GetTexCoordAt(const Triangle& triangle, float inverseArea, float x, float y)
+{
+    const glm::vec3* vertices = triangle.ScreenCoords;
+    const glm::vec2* uvs      = triangle.TexCoords;
+    glm::vec2        point(x, y);
+
+    float w1 = EdgeFunctionCCW(vertices[2], vertices[0], point) * inverseArea;
+    float w2 = EdgeFunctionCCW(vertices[0], vertices[1], point) * inverseArea;
+
+    return uvs[0] + (uvs[1] - uvs[0]) * w1 + (uvs[2] - uvs[0]) * w2;
+}
+
+// The mip level to sample the triangle's texture at, from the texture coordinate differences across the 2x2 quad of
+// pixels starting at (quadX, quadY). The triangle is extended over the pixels of the quad it doesn't cover, the way a
+// GPU runs helper pixels, so the differences are always taken within the same triangle.
+static float GetQuadTextureLod(const Triangle& triangle, const Texture& texture, int quadX, int quadY)
+{
+    // The fixed point setup can still find pixels in a triangle whose float area is zero, or so small that its inverse
+    // overflows. Its texture coordinates don't change across the screen in any meaningful way, so it gets the full
+    // resolution level rather than a NaN.
+    const glm::vec3* vertices    = triangle.ScreenCoords;
+    float            inverseArea = 1.0f / EdgeFunctionCCW(vertices[0], vertices[1], vertices[2]);
+    if (!std::isfinite(inverseArea))
+    {
+        return 0.0f;
+    }
+
+    float     x             = static_cast<float>(quadX);
+    float     y             = static_cast<float>(quadY);
+    glm::vec2 texCoord      = GetTexCoordAt(triangle, inverseArea, x, y);
+    glm::vec2 texCoordRight = GetTexCoordAt(triangle, inverseArea, x + 1.0f, y);
+    glm::vec2 texCoordUp    = GetTexCoordAt(triangle, inverseArea, x, y + 1.0f);
+
+    return ComputeTextureLod(texture, texCoordRight - texCoord, texCoordUp - texCoord);
+}
+
+// The number of lit pixels the color resolve collects before sampling their textures together
+const int RESOLVE_BATCH_SIZE = SAMPLE_BATCH_SIZE * 4;
+
+// Lit pixels waiting for their texture to be sampled, which all have the same shading state and level of detail
+struct PendingFragments
+{
+    const ShadingState* Shading    = nullptr;
+    float               TextureLod = 0.0f;
+    int                 Count      = 0;
+
+    float         U[RESOLVE_BATCH_SIZE];
+    float         V[RESOLVE_BATCH_SIZE];
+    float         LightIntensities[RESOLVE_BATCH_SIZE];
+    std::uint8_t* Pixels[RESOLVE_BATCH_SIZE];
+};
+
+static void ShadePendingFragments(PendingFragments& fragments, int bytesPerPixel)
+{
+    const ShadingState& shading = *fragments.Shading;
+
+    TGAColor colors[RESOLVE_BATCH_SIZE];
+    SampleTextureBatch(*shading.DiffuseTexture, shading.Sampler, fragments.U, fragments.V, fragments.TextureLod,
+                       fragments.Count, colors);
+
+    for (int i = 0; i < fragments.Count; i++)
+    {
+        TGAColor color = colors[i] * fragments.LightIntensities[i];
+        std::memcpy(fragments.Pixels[i], color.bgra, bytesPerPixel);
+    }
+
+    fragments.Count = 0;
+}
+
+void VisibilityBuffer::ResolveColor(const std::vector<Triangle>& triangles, const ShadingState& shading,
+                                    TGAImage& image, const PixelRect& rect) const
+{
+    std::vector<ShadingBatch> batches = {{0, static_cast<int>(triangles.size()), &shading}};
+    ResolveColor(triangles, batches, image, rect);
+}
+
+void VisibilityBuffer::ResolveColor(const std::vector<Triangle>& triangles, const std::vector<ShadingBatch>& batches,
+                                    TGAImage& image, const PixelRect& rect) const
+{
+    // Without any batches there are no triangles either, and nothing to shade
+    if (batches.empty())
+    {
+        return;
+    }
+
+    int bytesPerPixel = image.get_bytespp();
+
+    // Neighbouring pixels mostly belong to the same batch, so the batch of the last pixel is tried first before
+    // searching for the right one
+    const ShadingBatch* batch = batches.data();
+
+    auto startsAfter = [](int triangle, const ShadingBatch& batch) { return triangle < batch.FirstTriangle; };
+
+    // Texture coordinates are interpolated linearly in screen space, so every quad of a triangle ends up with the same
+    // level of detail, and it only needs working out again when the triangle changes
+    std::uint32_t lodPrimitiveId = EMPTY;
+    float         textureLod     = 0.0f;
+
+    // Pixels are lit one at a time, but their textures are sampled several at once
+    PendingFragments pending;
+
+    for (int y = rect.MinY; y <= rect.MaxY; y++)
+    {
+        size_t        pixelIndex = rect.MinX + static_cast<size_t>(y) * m_Width;
+        std::uint8_t* pixel      = image.buffer() + pixelIndex * bytesPerPixel;
+
+        for (int x = rect.MinX; x <= rect.MaxX; x++, pixelIndex++, pixel += bytesPerPixel)
+        {
+            std::uint32_t primitiveId = m_PrimitiveIds[pixelIndex];
+            if (primitiveId == EMPTY)
+            {
+                continue;
+            }
+
+            int triangle = static_cast<int>(primitiveId);
+            if (triangle < batch->FirstTriangle || triangle >= batch->FirstTriangle + batch->NumTriangles)
+            {
+                // The last batch starting at or before the triangle
+                batch = std::upper_bound(batches.data(), batches.data() + batches.size(), triangle, startsAfter) - 1;
+            }
+
+            const ShadingState& shading = *batch->Shading;
+            const Texture&      texture = *shading.DiffuseTexture;
+
+            bool isMipmapped = shading.Sampler.Filter == TextureFilter::Trilinear && !texture.MipLevels.empty();
+            if (primitiveId != lodPrimitiveId && isMipmapped)
+            {
+                // The quads start at even coordinates
+                textureLod     = GetQuadTextureLod(triangles[primitiveId], texture, x & ~1, y & ~1);
+                lodPrimitiveId = primitiveId;
+            }
+
+            float w0, w1, w2;
+            GetBarycentrics(pixelIndex, w0, w1, w2);
+
+            float     lightIntensity;
+            glm::vec2 texCoord;
+            if (!LightFragment(triangles[primitiveId], shading, w0, w1, w2, lightIntensity, texCoord))
+            {
+                continue;
+            }
+
+            if (pending.Count > 0 && (pending.Shading != &shading || pending.TextureLod != textureLod))
+            {
+                ShadePendingFragments(pending, bytesPerPixel);
+            }
+
+            pending.Shading    = &shading;
+            pending.TextureLod = textureLod;
+
+            pending.U[pending.Count]                = texCoord.x;
+            pending.V[pending.Count]                = texCoord.y;
+            pending.LightIntensities[pending.Count] = lightIntensity;
+            pending.Pixels[pending.Count]           = pixel;
+            pending.Count++;
+
+            if (pending.Count == RESOLVE_BATCH_SIZE)
+            {
+                ShadePendingFragments(pending, bytesPerPixel);
+            }
+        }
+    }
+
+    if (pending.Count > 0)
+    {
+        ShadePendingFragments(pending, bytesPerPixel);
+    }
+}
+
+void VisibilityBuffer::ResolveNormal(const std::vector<Triangle>& triangles, TGAImage& image,
+                                     const PixelRect& rect) const
+{
+    for (int y = rect.MinY; y <= rect.MaxY; y++)
+    {
+        for (int x = rect.MinX; x <= rect.MaxX; x++)
+        {
+            size_t        pixelIndex  = x + static_cast<size_t>(y) * m_Width;
+            std::uint32_t primitiveId = m_PrimitiveIds[pixelIndex];
+            if (primitiveId == EMPTY)
+            {
+                continue;
+            }
+
+            float w0, w1, w2;
+            GetBarycentrics(pixelIndex, w0, w1, w2);
+
+            const glm::vec3* normals = triangles[primitiveId].Normals;
+            glm::vec3        normal  = glm::normalize(normals[0] * w0 + normals[1] * w1 + normals[2] * w2);
+            glm::vec3        encoded = (normal + glm::vec3(1.0f)) * 127.5f;
+
+            image.set(x, y, TGAColor(encoded.x, encoded.y, encoded.z));
+        }
+    }
+}
+
+void VisibilityBuffer::ResolveDepth(const std::vector<Triangle>& triangles, float* depthBuffer,
+                                    const PixelRect& rect) const
+{
+    for (int y = rect.MinY; y <= rect.MaxY; y++)
+    {
+        for (int x = rect.MinX; x <= rect.MaxX; x++)
+        {
+            size_t        pixelIndex  = x + static_cast<size_t>(y) * m_Width;
+            std::uint32_t primitiveId = m_PrimitiveIds[pixelIndex];
+            if (primitiveId == EMPTY)
+            {
+                continue;
+            }
+
+            float w0, w1, w2;
+            GetBarycentrics(pixelIndex, w0, w1, w2);
+
+            const glm::vec3* vertices = triangles[primitiveId].ScreenCoords;
+            depthBuffer[pixelIndex]   = vertices[0].z * w0 + vertices[1].z * w1 + vertices[2].z * w2;
+        }
+    }
+}
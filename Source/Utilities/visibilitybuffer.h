@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Utilities/tgaimage.h"
+
+struct Triangle;
+struct ShadingState;
+struct ShadingBatch;
+struct PixelRect;
+
+// A render target that stores, for every pixel, which triangle is visible there and where on that triangle the pixel
+// is, instead of a color. That is everything needed to shade the pixel, so a frame rendered once can be resolved into
+// color, normal and depth images as many times as needed, for instance with a different texture or light, without
+// rasterizing any geometry again.
+//
+// Per pixel, this takes a 32 bit primitive id and two barycentric coordinates stored as 16 bit unsigned normalized
+// integers, 8 bytes in total. The third coordinate is not stored since the three always add up to 1.
+class VisibilityBuffer
+{
+
+  public:
+    // The primitive id of pixels no triangle has been drawn to
+    static constexpr std::uint32_t EMPTY = 0xffffffff;
+
+    VisibilityBuffer(int width, int height);
+
+    // Marks every pixel as empty, to be done along with clearing the zBuffer
+    void Clear();
+
+    // Records that the triangle with the given index is visible at the pixel, with barycentric coordinates
+    // (1 - w1 - w2, w1, w2). Both w1 and w2 are expected to be in [0, 1].
+    inline void Write(size_t pixelIndex, std::uint32_t primitiveId, float w1, float w2)
+    {
+        m_PrimitiveIds[pixelIndex]         = primitiveId;
+        m_Barycentrics[pixelIndex * 2]     = EncodeBarycentric(w1);
+        m_Barycentrics[pixelIndex * 2 + 1] = EncodeBarycentric(w2);
+    }
+
+    inline std::uint32_t GetPrimitiveId(size_t pixelIndex) const { return m_PrimitiveIds[pixelIndex]; }
+
+    // The three barycentric coordinates of the pixel, only meaningful when its primitive id is not EMPTY
+    void GetBarycentrics(size_t pixelIndex, float& w0, float& w1, float& w2) const;
+
+    // The resolves below only touch the pixels of rect that have a triangle, and read the triangles from the same list
+    // that was rendered into the buffer. Different rects can be resolved in parallel.
+
+    // Shades the visible pixels into the image, exactly like the forward backends would have. The exception is
+    // trilinear filtering of textures with a mip chain, at a level of detail worked out per 2x2 pixel quad. The
+    // forward backends draw one pixel at a time, without any quads to take texture coordinate differences across, and
+    // always sample the full resolution level.
+    //
+    // The lit pixels are collected and their textures sampled several at a time with SampleTextureBatch.
+    void ResolveColor(const std::vector<Triangle>& triangles, const ShadingState& shading, TGAImage& image,
+                      const PixelRect& rect) const;
+
+    // Same, shading every triangle with the state of the batch it is in
+    void ResolveColor(const std::vector<Triangle>& triangles, const std::vector<ShadingBatch>& batches,
+                      TGAImage& image, const PixelRect& rect) const;
+
+    // Writes the interpolated normals, mapped from [-1, 1] to [0, 255] per channel
+    void ResolveNormal(const std::vector<Triangle>& triangles, TGAImage& image, const PixelRect& rect) const;
+
+    // Writes the interpolated screen depths into depthBuffer, which has one float per pixel like the zBuffer. Due to
+    // the 16 bit barycentrics, these can differ from the zBuffer by a tiny amount.
+    void ResolveDepth(const std::vector<Triangle>& triangles, float* depthBuffer, const PixelRect& rect) const;
+
+    inline int GetWidth() const { return m_Width; }
+    inline int GetHeight() const { return m_Height; }
+
+  private:
+    static inline std::uint16_t EncodeBarycentric(float w)
+    {
+        // Pixels right on an edge can end up a hair outside [0, 1] due to float rounding
+        w = w < 0.0f ? 0.0f : (w > 1.0f ? 1.0f : w);
+        return static_cast<std::uint16_t>(w * 65535.0f + 0.5f);
+    }
+
+    int m_Width;
+    int m_Height;
+
+    std::vector<std::uint32_t> m_PrimitiveIds;
+    // Two per pixel, interleaved so that both are read from the same cache line
+    std::vector<std::uint16_t> m_Barycentrics;
+};